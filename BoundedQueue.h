@@ -0,0 +1,81 @@
+#pragma once
+#include <mutex>
+#include <condition_variable>
+#include <queue>
+#include <chrono>
+
+//fixed capacity queue for handing work from one stage of a pipeline to the next
+//push blocks while the queue is full, so a fast producer can't run away from a slow consumer
+template <typename T>
+class BoundedQueue
+{
+private:
+	std::queue<T> items;
+	size_t capacity;
+	bool closed = false;
+	std::mutex lock;
+	std::condition_variable not_full;
+	std::condition_variable not_empty;
+public:
+	BoundedQueue(size_t capacity) : capacity(capacity == 0 ? 1 : capacity) {}
+	BoundedQueue(const BoundedQueue&) = delete;
+	BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+	//returns false if the queue has been closed
+	bool push(T item) {
+		std::unique_lock<std::mutex> guard(lock);
+		not_full.wait(guard, [this] { return closed || items.size() < capacity; });
+		if (closed) {
+			return false;
+		}
+		items.push(std::move(item));
+		not_empty.notify_one();
+		return true;
+	}
+
+	//blocks until an item is available. returns false once the queue is closed and empty
+	bool pop(T& out) {
+		std::unique_lock<std::mutex> guard(lock);
+		not_empty.wait(guard, [this] { return closed || !items.empty(); });
+		if (items.empty()) {
+			return false;
+		}
+		out = std::move(items.front());
+		items.pop();
+		not_full.notify_one();
+		return true;
+	}
+
+	//as pop, but gives up after timeout. check is_closed() to tell a timeout from the end of the queue
+	template <class Rep, class Period>
+	bool pop_for(T& out, const std::chrono::duration<Rep, Period>& timeout) {
+		std::unique_lock<std::mutex> guard(lock);
+		if (!not_empty.wait_for(guard, timeout, [this] { return closed || !items.empty(); }) || items.empty()) {
+			return false;
+		}
+		out = std::move(items.front());
+		items.pop();
+		not_full.notify_one();
+		return true;
+	}
+
+	bool is_closed() {
+		std::lock_guard<std::mutex> guard(lock);
+		return closed;
+	}
+
+	//no more items will be pushed; consumers drain what is left and then stop
+	void close() {
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			closed = true;
+		}
+		not_full.notify_all();
+		not_empty.notify_all();
+	}
+
+	size_t size() {
+		std::lock_guard<std::mutex> guard(lock);
+		return items.size();
+	}
+};
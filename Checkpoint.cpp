@@ -0,0 +1,93 @@
+#include "Checkpoint.h"
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <boost/json.hpp>
+
+using namespace std;
+
+IngestCheckpoint::IngestCheckpoint(const string& path) : path(path)
+{
+};
+
+bool IngestCheckpoint::load()
+{
+	ifstream in(path);
+	if (!in) {
+		return false;
+	}
+	stringstream contents;
+	contents << in.rdbuf();
+	//a checkpoint cut short or with anything missing or mangled is an error rather than a fresh start, which would upload
+	//everything again. nothing is changed unless the whole checkpoint reads back
+	set<string> files;
+	string file;
+	uint64_t file_offset;
+	int64_t tweets, users;
+	try {
+		boost::json::object checkpoint = boost::json::parse(contents.str()).as_object();
+		for (const auto& completed : checkpoint.at("completed_files").as_array()) {
+			files.insert(string(completed.as_string()));
+		}
+		file = string(checkpoint.at("current_file").as_string());
+		file_offset = checkpoint.at("offset").to_number<uint64_t>();
+		tweets = checkpoint.at("tweets_processed").to_number<int64_t>();
+		users = checkpoint.at("users_processed").to_number<int64_t>();
+	} catch (const exception& e) {
+		throw runtime_error("Checkpoint " + path + " is corrupt (" + e.what() + "), delete it to start the ingest over");
+	}
+	completed_files = move(files);
+	current_file = move(file);
+	offset = file_offset;
+	tweets_processed = tweets;
+	users_processed = users;
+	return true;
+};
+
+void IngestCheckpoint::save()
+{
+	boost::json::array completed;
+	for (const string& file : completed_files) {
+		completed.emplace_back(file);
+	}
+	boost::json::object checkpoint;
+	checkpoint["completed_files"] = completed;
+	checkpoint["current_file"] = current_file;
+	checkpoint["offset"] = offset;
+	checkpoint["tweets_processed"] = tweets_processed;
+	checkpoint["users_processed"] = users_processed;
+
+	string temp_path = path + ".tmp";
+	{
+		ofstream out(temp_path, ios_base::out | ios_base::trunc);
+		out << boost::json::serialize(checkpoint);
+		out.close();
+		if (!out) {
+			throw runtime_error("Could not write checkpoint " + temp_path);
+		}
+	}
+	filesystem::rename(temp_path, path);
+};
+
+void IngestCheckpoint::remove()
+{
+	error_code error;
+	filesystem::remove(path, error);
+};
+
+bool IngestCheckpoint::is_completed(const string& file) const
+{
+	return completed_files.find(file) != completed_files.end();
+};
+
+uint64_t IngestCheckpoint::resume_offset(const string& file) const
+{
+	return file == current_file ? offset : 0;
+};
+
+void IngestCheckpoint::complete_file(const string& file)
+{
+	completed_files.insert(file);
+	current_file = "";
+	offset = 0;
+};
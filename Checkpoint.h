@@ -0,0 +1,31 @@
+#pragma once
+#include "utilities.h"
+#include <set>
+#include <string>
+
+//progress of an ingestion run, saved to disk so a failed run can pick up where it left off
+//only ever saved at a point where everything before offset has been parsed and successfully inserted
+class IngestCheckpoint
+{
+private:
+	std::string path;
+public:
+	std::set<std::string> completed_files;
+	std::string current_file;
+	uint64_t offset = 0;	//bytes of current_file (after decompression) that are done
+	int64_t tweets_processed = 0;
+	int64_t users_processed = 0;
+
+	IngestCheckpoint(const std::string& path);
+
+	//returns false if there is no checkpoint to resume from. throws runtime_error if the checkpoint is there but can't be read
+	bool load();
+	//written to a temporary file and renamed over the old one, so a crash mid-save leaves the previous checkpoint intact
+	void save();
+	void remove();
+
+	bool is_completed(const std::string& file) const;
+	//where to start reading file from
+	uint64_t resume_offset(const std::string& file) const;
+	void complete_file(const std::string& file);
+};
@@ -0,0 +1,245 @@
+#include "CommunityDetection.h"
+#include "ThreadPool.h"
+#include <libleidenalg/CPMVertexPartition.h>
+#include <libleidenalg/RBConfigurationVertexPartition.h>
+#include <unordered_map>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+using namespace std;
+
+ResolutionQuality parse_resolution_quality(const string& name)
+{
+	if (name == "cpm") {
+		return ResolutionQuality::CPM;
+	}
+	if (name == "rb") {
+		return ResolutionQuality::RBConfiguration;
+	}
+	throw invalid_argument("Unknown quality function " + name + ", expected cpm or rb");
+};
+
+vector<double> interaction_weights(const igraph_t* graph)
+{
+	if (!igraph_cattribute_has_attr(graph, IGRAPH_ATTRIBUTE_EDGE, "weight")) {
+		return vector<double>();
+	}
+	igraph_vector_t weights;
+	igraph_vector_init(&weights, 0);
+	igraph_cattribute_EANV(graph, "weight", igraph_ess_all(IGRAPH_EDGEORDER_ID), &weights);
+	vector<double> out(VECTOR(weights), VECTOR(weights) + igraph_vector_size(&weights));
+	igraph_vector_destroy(&weights);
+	return out;
+};
+
+double membership_nmi(const vector<size_t>& a, const vector<size_t>& b)
+{
+	if (a.size() != b.size()) {
+		throw invalid_argument("Memberships are for different numbers of vertices");
+	}
+	double n = (double)a.size();
+	if (a.empty()) {
+		return 1;
+	}
+	unordered_map<size_t, size_t> a_sizes, b_sizes;
+	unordered_map<uint64_t, size_t> joint_sizes;
+	for (size_t v = 0; v < a.size(); v++) {
+		a_sizes[a[v]]++;
+		b_sizes[b[v]]++;
+		joint_sizes[((uint64_t)a[v] << 32) ^ (uint64_t)b[v]]++;
+	}
+	auto entropy = [n](const auto& sizes) {
+		double h = 0;
+		for (const auto& [community, size] : sizes) {
+			h -= size / n * log(size / n);
+		}
+		return h;
+	};
+	double h_a = entropy(a_sizes);
+	double h_b = entropy(b_sizes);
+	if (h_a == 0 && h_b == 0) {
+		return 1;	//both put everything in one community
+	}
+	double mutual = h_a + h_b - entropy(joint_sizes);
+	return 2 * mutual / (h_a + h_b);
+};
+
+//optimises partition until an iteration no longer improves it
+static LeidenRun optimise(MutableVertexPartition& partition, size_t seed)
+{
+	auto start = chrono::high_resolution_clock::now();
+	LeidenRun run;
+	run.seed = seed;
+	Optimiser optimiser;
+	optimiser.set_rng_seed(seed);
+	do {
+		run.iterations++;
+	} while (optimiser.optimise_partition(&partition) > 0);
+	run.quality = partition.quality();
+	run.membership = partition.membership();
+	run.seconds = chrono::duration<double>(chrono::high_resolution_clock::now() - start).count();
+	return run;
+};
+
+static LeidenRun optimise(Graph* graph, size_t seed, const vector<size_t>* initial_membership)
+{
+	if (initial_membership != NULL) {
+		ModularityVertexPartition partition(graph, *initial_membership);
+		return optimise(partition, seed);
+	}
+	ModularityVertexPartition partition(graph);
+	return optimise(partition, seed);
+};
+
+static ptr<Graph> make_graph(igraph_t* graph, const vector<double>* edge_weights)
+{
+	return edge_weights != NULL ? _ptr<Graph>(graph, *edge_weights) : _ptr<Graph>(graph);
+};
+
+LeidenRun run_leiden(igraph_t* graph, const vector<double>* edge_weights, size_t seed, const vector<size_t>* initial_membership)
+{
+	ptr<Graph> leiden_graph = make_graph(graph, edge_weights);
+	return optimise(leiden_graph.get(), seed, initial_membership);
+};
+
+LeidenEnsemble leiden_ensemble(igraph_t* graph, const vector<double>* edge_weights, size_t runs, size_t first_seed, const vector<size_t>* initial_membership)
+{
+	LeidenEnsemble ensemble;
+	runs = max<size_t>(runs, 1);
+
+	//the Graphs are created here rather than in the tasks, so igraph is only ever read concurrently
+	vector<ptr<Graph>> graphs;
+	for (size_t i = 0; i < runs; i++) {
+		graphs.push_back(make_graph(graph, edge_weights));
+	}
+	vector<future<LeidenRun>> pending;
+	for (size_t i = 0; i < runs; i++) {
+		ptr<Graph> run_graph = graphs[i];
+		size_t seed = first_seed + i;
+		pending.push_back(ThreadPool::getInstance()->submit([run_graph, seed, initial_membership]() {
+			return optimise(run_graph.get(), seed, initial_membership);
+		}));
+	}
+	for (auto& run : pending) {
+		ensemble.runs.push_back(run.get());
+	}
+	graphs.clear();
+
+	for (size_t i = 1; i < ensemble.runs.size(); i++) {
+		if (ensemble.runs[i].quality > ensemble.runs[ensemble.best].quality) {
+			ensemble.best = i;
+		}
+	}
+
+	//co-assignment is summarised over the edges, since the full vertex x vertex matrix would be far too big
+	igraph_integer_t edge_count = igraph_ecount(graph);
+	ensemble.edge_agreement.assign(edge_count, 0);
+	size_t stable = 0;
+	for (igraph_integer_t e = 0; e < edge_count; e++) {
+		igraph_integer_t from = IGRAPH_FROM(graph, e);
+		igraph_integer_t to = IGRAPH_TO(graph, e);
+		size_t together = 0;
+		for (const LeidenRun& run : ensemble.runs) {
+			together += run.membership[from] == run.membership[to];
+		}
+		ensemble.edge_agreement[e] = (float)together / runs;
+		stable += together == 0 || together == runs;
+	}
+	ensemble.stable_edges = edge_count == 0 ? 1 : (double)stable / edge_count;
+
+	if (runs > 1) {
+		double nmi_total = 0;
+		for (size_t i = 0; i < runs; i++) {
+			if (i != ensemble.best) {
+				nmi_total += membership_nmi(ensemble.best_run().membership, ensemble.runs[i].membership);
+			}
+		}
+		ensemble.mean_nmi = nmi_total / (runs - 1);
+	}
+	return ensemble;
+};
+
+void save_user_communities(const string& path, const UserIndex& users, const vector<size_t>& membership)
+{
+	ofstream out(path, ios_base::out | ios_base::trunc);
+	for (uint32_t v = 0; v < users.size(); v++) {
+		out << users.user_id(v) << "," << membership[v] << "\n";
+	}
+	out.close();
+	if (!out) {
+		throw runtime_error("Could not write communities to " + path);
+	}
+};
+
+user_communities load_user_communities(const string& path)
+{
+	ifstream in(path);
+	if (!in) {
+		throw runtime_error("Could not read communities from " + path);
+	}
+	user_communities communities;
+	string line;
+	while (getline(in, line)) {
+		size_t comma = line.find(',');
+		if (comma == string::npos) {
+			continue;
+		}
+		communities[stoull(line.substr(0, comma))] = stoull(line.substr(comma + 1));
+	}
+	return communities;
+};
+
+vector<size_t> carry_over_membership(const UserIndex& users, const user_communities& previous, size_t* carried_over)
+{
+	vector<size_t> membership(users.size());
+	unordered_map<size_t, size_t> renumbered;
+	size_t found = 0;
+	for (uint32_t v = 0; v < users.size(); v++) {
+		auto community = previous.find(users.user_id(v));
+		if (community != previous.end()) {
+			found++;
+			//previous communities are numbered in order of first appearance, new users after them
+			auto [number, inserted] = renumbered.try_emplace(community->second, renumbered.size());
+			membership[v] = number->second;
+		} else {
+			membership[v] = SIZE_MAX;
+		}
+	}
+	size_t next = renumbered.size();
+	for (size_t& community : membership) {
+		if (community == SIZE_MAX) {
+			community = next++;
+		}
+	}
+	if (carried_over != NULL) {
+		*carried_over = found;
+	}
+	return membership;
+};
+
+ResolutionSweep resolution_sweep(igraph_t* graph, const vector<double>& edge_weights, ResolutionQuality quality, const vector<double>& resolutions, size_t seed)
+{
+	ResolutionSweep sweep;
+	auto start = chrono::high_resolution_clock::now();
+	ptr<Graph> leiden_graph = make_graph(graph, edge_weights.empty() ? NULL : &edge_weights);
+	sweep.graph_seconds = chrono::duration<double>(chrono::high_resolution_clock::now() - start).count();
+
+	vector<size_t> previous;
+	for (double resolution : resolutions) {
+		ptr<MutableVertexPartition> partition;
+		if (quality == ResolutionQuality::CPM) {
+			partition = previous.empty() ? _ptr<CPMVertexPartition>(leiden_graph.get(), resolution)
+				: _ptr<CPMVertexPartition>(leiden_graph.get(), previous, resolution);
+		} else {
+			partition = previous.empty() ? _ptr<RBConfigurationVertexPartition>(leiden_graph.get(), resolution)
+				: _ptr<RBConfigurationVertexPartition>(leiden_graph.get(), previous, resolution);
+		}
+		LeidenRun run = optimise(*partition, seed);
+		run.resolution = resolution;
+		previous = run.membership;
+		sweep.runs.push_back(move(run));
+	}
+	sweep.total_seconds = chrono::duration<double>(chrono::high_resolution_clock::now() - start).count();
+	return sweep;
+};
@@ -0,0 +1,75 @@
+#pragma once
+#include "utilities.h"
+#include "UserIndex.h"
+#include <string>
+#include <unordered_map>
+
+//the result of optimising one partition to convergence
+struct LeidenRun {
+	size_t seed = 0;
+	double resolution = 1;	//for the resolution based quality functions
+	double quality = 0;
+	double seconds = 0;
+	size_t iterations = 0;	//Leiden iterations until one no longer improved the partition
+	std::vector<size_t> membership;	//community of each vertex
+};
+
+//the same optimisation run with several seeds, and how much the runs agree
+struct LeidenEnsemble {
+	std::vector<LeidenRun> runs;
+	size_t best = 0;	//index of the run with the highest quality
+	//for each edge, the fraction of runs that put its endpoints in the same community
+	std::vector<float> edge_agreement;
+	//fraction of edges on which every run agrees (always together, or always apart)
+	double stable_edges = 1;
+	//normalised mutual information between the best partition and each of the others, averaged
+	double mean_nmi = 1;
+
+	const LeidenRun& best_run() const { return runs[best]; }
+};
+
+//quality functions with a resolution parameter: higher resolutions give more, smaller communities
+enum class ResolutionQuality { CPM, RBConfiguration };
+
+//a ladder of resolutions, optimised on one weighted Graph
+struct ResolutionSweep {
+	std::vector<LeidenRun> runs;	//one per resolution, in the order given
+	double graph_seconds = 0;	//creating the leidenalg Graph, which is shared by every resolution
+	double total_seconds = 0;
+};
+
+//parses "cpm" or "rb" (RB configuration, ie. modularity with a resolution)
+ResolutionQuality parse_resolution_quality(const std::string& name);
+
+//the "weight" attribute (interaction counts) of each edge, in edge ID order. empty if the graph has none
+std::vector<double> interaction_weights(const igraph_t* graph);
+
+//normalised mutual information between two memberships of the same vertices: 1 for the same partition, near 0 for unrelated ones
+double membership_nmi(const std::vector<size_t>& a, const std::vector<size_t>& b);
+
+//runs Leiden on modularity until an iteration no longer improves it, weighted by edge_weights if given
+//starts from initial_membership if given (eg. from carry_over_membership), otherwise from singletons
+LeidenRun run_leiden(igraph_t* graph, const std::vector<double>* edge_weights, size_t seed, const std::vector<size_t>* initial_membership = NULL);
+
+//runs Leiden with seeds first_seed, first_seed + 1, ... concurrently on the thread pool and keeps the best partition
+//leidenalg's Graph caches neighbour lists as it is read, so it can't be shared between threads; each run gets its own Graph
+//over the same igraph_t instead, which holds degrees and weights but not another copy of the edges
+//every run starts from initial_membership if given
+LeidenEnsemble leiden_ensemble(igraph_t* graph, const std::vector<double>* edge_weights, size_t runs, size_t first_seed = 0, const std::vector<size_t>* initial_membership = NULL);
+
+//a partition found earlier, as user ID -> community, so it can be carried over to a graph with different vertex IDs
+using user_communities = std::unordered_map<uint64_t, size_t>;
+
+//writes each user's community as "user,community" lines
+void save_user_communities(const std::string& path, const UserIndex& users, const std::vector<size_t>& membership);
+//throws runtime_error if the file can't be read
+user_communities load_user_communities(const std::string& path);
+
+//a starting membership for the users of a new graph: users in previous keep their community, new users start on their own
+//communities are renumbered 0, 1, 2, ... as leidenalg expects. carried_over is set to the number of users found in previous
+std::vector<size_t> carry_over_membership(const UserIndex& users, const user_communities& previous, size_t* carried_over = NULL);
+
+//optimises the partition at each resolution, in the order given, starting each from the membership found at the previous one
+//(so a ladder of increasing resolutions only has to split communities, rather than rebuild them from singletons every time)
+//the weighted Graph is created once and shared by every resolution
+ResolutionSweep resolution_sweep(igraph_t* graph, const std::vector<double>& edge_weights, ResolutionQuality quality, const std::vector<double>& resolutions, size_t seed = 0);
@@ -0,0 +1,81 @@
+#include "CommunityObservers.h"
+#include "ThreadPool.h"
+#include <future>
+
+using namespace std;
+
+//members checked by one task, so that a single giant community still gets spread over the pool
+static const size_t members_per_task = 4096;
+
+vector<CommunityObservers> community_observers(const igraph_t* g, const vector<size_t>& membership, ubyte m, ubyte k,
+	const vector<double>* edge_weights, bool weighted)
+{
+	if (membership.size() != (size_t)igraph_vcount(g)) {
+		throw invalid_argument("Membership has " + to_string(membership.size()) + " entries for " + to_string(igraph_vcount(g)) + " vertices");
+	}
+
+	//bucket the vertices by community
+	size_t community_count = 0;
+	for (size_t community : membership) {
+		community_count = max(community_count, community + 1);
+	}
+	vector<vector<uint32_t>> members(community_count);
+	for (uint32_t v = 0; v < membership.size(); v++) {
+		members[membership[v]].push_back(v);
+	}
+
+	vector<CommunityObservers> results;
+	for (size_t community = 0; community < community_count; community++) {
+		if (members[community].size() >= k) {
+			CommunityObservers result;
+			result.community = community;
+			result.size = members[community].size();
+			results.push_back(move(result));
+		}
+	}
+	stable_sort(results.begin(), results.end(), [](const CommunityObservers& a, const CommunityObservers& b) {
+		return a.size > b.size;
+	});
+
+	//each task gets its own view, views share nothing but the read-only graph
+	struct Found {
+		vector<uint32_t> observers;
+		double seconds = 0;
+		CrowdStats stats;
+	};
+	struct Task {
+		size_t result;
+		future<Found> found;
+	};
+	vector<Task> tasks;
+	ThreadPool* thread_pool = ThreadPool::getInstance();
+	for (size_t r = 0; r < results.size(); r++) {
+		const vector<uint32_t>& community_members = members[results[r].community];
+		for (size_t begin = 0; begin < community_members.size(); begin += members_per_task) {
+			size_t end = min(community_members.size(), begin + members_per_task);
+			tasks.push_back({ r, thread_pool->submit([&, r, begin, end]() {
+				auto start = chrono::high_resolution_clock::now();
+				Crowd crowd(g, membership, results[r].community, edge_weights, weighted);
+				Found found;
+				for (size_t i = begin; i < end; i++) {
+					if (crowd.is_mk_observer(community_members[i], m, k)) {
+						found.observers.push_back(community_members[i]);
+					}
+				}
+				found.seconds = chrono::duration<double>(chrono::high_resolution_clock::now() - start).count();
+				found.stats = crowd.total_stats();
+				return found;
+			}) });
+		}
+	}
+
+	//tasks were submitted community by community in member order, so appending keeps each community's observers ascending
+	for (Task& task : tasks) {
+		Found found = task.found.get();
+		CommunityObservers& result = results[task.result];
+		result.observers.insert(result.observers.end(), found.observers.begin(), found.observers.end());
+		result.seconds += found.seconds;
+		result.stats += found.stats;
+	}
+	return results;
+}
@@ -0,0 +1,20 @@
+#pragma once
+#include "utilities.h"
+#include "Crowd.h"
+
+//the (m,k)-observers of one community, with the community analysed as a crowd of its own
+struct CommunityObservers {
+	size_t community = 0;
+	size_t size = 0;	//members
+	std::vector<uint32_t> observers;	//vertex IDs, ascending
+	double seconds = 0;	//time spent on the community, summed across the threads that shared it
+	CrowdStats stats;	//summed across the community's views, if Crowd counts
+};
+
+//finds the (m,k)-observers of every community in membership, each community on its own through a Crowd view of g
+//communities run concurrently on the ThreadPool, largest first so that the big ones don't hold up the end,
+//and the members of big communities are split between several tasks. no subgraphs are copied
+//edge_weights (if given) and weighted work as for Crowd. communities with fewer than k members can't have observers and are left out
+//results are largest community first
+std::vector<CommunityObservers> community_observers(const igraph_t* g, const std::vector<size_t>& membership, ubyte m, ubyte k,
+	const std::vector<double>* edge_weights = NULL, bool weighted = false);
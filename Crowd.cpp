@@ -1,13 +1,78 @@
 #include "Crowd.h"
+#include <unordered_map>
 
 using namespace std;
 
+#if POLPOL_CROWD_STATS
+#define CROWD_COUNT(counter, n) (current.counter += (n))
+#else
+#define CROWD_COUNT(counter, n) ((void)0)
+#endif
+
+#if POLPOL_CROWD_STATS && POLPOL_CROWD_TIMERS
+//adds the time from its construction to stop() (or its destruction) to a stage's seconds
+class StageTimer
+{
+private:
+	double* seconds;
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+public:
+	StageTimer(double& seconds) : seconds(&seconds) {}
+	~StageTimer() { stop(); }
+	void stop() {
+		if (seconds != NULL) {
+			*seconds += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+			seconds = NULL;
+		}
+	}
+};
+#define CROWD_TIMER(timer, stage) StageTimer timer(current.stage)
+#define CROWD_STOP(timer) timer.stop()
+#else
+#define CROWD_TIMER(timer, stage)
+#define CROWD_STOP(timer)
+#endif
+
+CrowdStats& CrowdStats::operator+=(const CrowdStats& other)
+{
+	calls += other.calls;
+	neighbours += other.neighbours;
+	pairs_tested += other.pairs_tested;
+	searches += other.searches;
+	vertices_expanded += other.vertices_expanded;
+	clique_candidates += other.clique_candidates;
+	cliques_grown += other.cliques_grown;
+	neighbour_seconds += other.neighbour_seconds;
+	pair_seconds += other.pair_seconds;
+	search_seconds += other.search_seconds;
+	clique_seconds += other.clique_seconds;
+	return *this;
+}
+
+bool Crowd::counts_stats()
+{
+	return POLPOL_CROWD_STATS != 0;
+}
+
+CrowdStats Crowd::total_stats() const
+{
+	CrowdStats total = finished_calls;
+	total += current;
+	return total;
+}
+
+void Crowd::reset_stats()
+{
+	current = CrowdStats();
+	finished_calls = CrowdStats();
+}
+
 Crowd::Crowd(ptr<Graph> G, bool weighted, string node_key)
 {
 	graph = G;
 	i_graph = G->get_igraph();
 	max_m = max_m;
-	node_key = node_key;
+	this->node_key = node_key;
 	if (weighted) {
 		weights = new igraph_vector_t();
 		igraph_vector_init(weights, 0);
@@ -19,7 +84,7 @@ Crowd::Crowd(igraph_t* i_g, bool weighted, string node_key)
 {
 	i_graph = i_g;
 	graph = _ptr<Graph>(i_g);
-	node_key = node_key;
+	this->node_key = node_key;
 	if (weighted) {
 		weights = new igraph_vector_t();
 		igraph_vector_init(weights, 0);
@@ -27,16 +92,60 @@ Crowd::Crowd(igraph_t* i_g, bool weighted, string node_key)
 	}
 };
 
+Crowd::Crowd(igraph_t* i_g, const vector<double>& edge_weights, bool weighted, string node_key)
+{
+	if ((igraph_integer_t)edge_weights.size() != igraph_ecount(i_g)) {
+		throw invalid_argument("Crowd needs a weight for each of the " + to_string(igraph_ecount(i_g)) + " edges, got " + to_string(edge_weights.size()));
+	}
+	i_graph = i_g;
+	graph = _ptr<Graph>(i_g, edge_weights);
+	this->node_key = node_key;
+	//edges that aren't in the crowd get an infinite length, which dijkstra ignores
+	weights = new igraph_vector_t();
+	igraph_vector_init(weights, edge_weights.size());
+	edge_in_crowd.resize(edge_weights.size());
+	for (size_t e = 0; e < edge_weights.size(); e++) {
+		edge_in_crowd[e] = edge_weights[e] != 0;
+		VECTOR(*weights)[e] = !edge_in_crowd[e] ? IGRAPH_INFINITY : (weighted ? edge_weights[e] : 1);
+	}
+};
+
+Crowd::Crowd(const igraph_t* shared_graph, const vector<size_t>& membership, size_t community, const vector<double>* edge_weights, bool weighted)
+{
+	//views never modify the graph
+	i_graph = const_cast<igraph_t*>(shared_graph);
+	owns_graph = false;
+	this->membership = &membership;
+	this->community = community;
+	view_weights = edge_weights;
+	weighted_view = weighted;
+};
+
 Crowd::~Crowd()
 {
 	if (weights != NULL) {
 		igraph_vector_destroy(weights);
 		delete weights;
 	}
-	igraph_destroy(i_graph);
-	delete i_graph;
+	if (owns_graph) {
+		igraph_destroy(i_graph);
+		delete i_graph;
+	}
 };
 
+//the length of edge e in a view, infinite if the edge isn't in the crowd
+double Crowd::edge_length(igraph_integer_t e) const
+{
+	if (view_weights == NULL) {
+		return 1;
+	}
+	double weight = (*view_weights)[e];
+	if (weight == 0) {
+		return IGRAPH_INFINITY;
+	}
+	return weighted_view ? weight : 1;
+}
+
 bool Crowd::is_mk_observer(uint v, ubyte m, ubyte k)
 {
 	if (verbose) { cout << "Checking if vertex " << v << " is an (" << (int)m << "," << (int)k << ")-observer" << endl; }
@@ -57,22 +166,60 @@ bool Crowd::is_mk_observer(uint v, ubyte m, ubyte k)
 		throw std::invalid_argument("Invalid m or k value. m needs to be integer >= 1; k needs to be integer > 1.");
 	}
 
-	//TODO: refactor to just use the igraph neighbours object directly
-	igraph_vs_t* neighbours = new igraph_vs_t();
-	igraph_vs_adj(neighbours, v, IGRAPH_IN);
-	igraph_vit_t* neighbours_iterator = new igraph_vit_t();
-	igraph_vit_create(graph->get_igraph(), *neighbours, neighbours_iterator);
-	ptr<vector<uint>> neighbour_list = _ptr<vector<uint>>();
-	while (!IGRAPH_VIT_END(*neighbours_iterator)) {
-		neighbour_list->push_back(IGRAPH_VIT_GET(*neighbours_iterator));
-		IGRAPH_VIT_NEXT(*neighbours_iterator);
+#if POLPOL_CROWD_STATS
+	finished_calls += current;
+	current = CrowdStats();
+#endif
+	CROWD_COUNT(calls, 1);
+
+	if (!in_crowd(v)) {
+		return false;
 	}
 
-	// Clean up neighbours and neighbours_iterator
-	igraph_vit_destroy(neighbours_iterator);
-	delete neighbours_iterator;
-	igraph_vs_destroy(neighbours);
-	delete neighbours;
+	CROWD_TIMER(neighbour_timer, neighbour_seconds);
+	ptr<vector<uint>> neighbour_list = _ptr<vector<uint>>();
+	if (membership != NULL) {
+		igraph_vector_int_t incident;
+		igraph_vector_int_init(&incident, 0);
+		igraph_incident(i_graph, &incident, v, IGRAPH_IN);
+		for (igraph_integer_t i = 0; i < igraph_vector_int_size(&incident); i++) {
+			igraph_integer_t e = VECTOR(incident)[i];
+			igraph_integer_t neighbour = IGRAPH_OTHER(i_graph, e, v);
+			if (in_crowd(neighbour) && edge_length(e) != IGRAPH_INFINITY) {
+				neighbour_list->push_back(neighbour);
+			}
+		}
+		igraph_vector_int_destroy(&incident);
+	} else if (!edge_in_crowd.empty()) {
+		igraph_vector_int_t incident;
+		igraph_vector_int_init(&incident, 0);
+		igraph_incident(i_graph, &incident, v, IGRAPH_IN);
+		for (igraph_integer_t i = 0; i < igraph_vector_int_size(&incident); i++) {
+			igraph_integer_t e = VECTOR(incident)[i];
+			if (edge_in_crowd[e]) {
+				neighbour_list->push_back(IGRAPH_OTHER(i_graph, e, v));
+			}
+		}
+		igraph_vector_int_destroy(&incident);
+	} else {
+		//TODO: refactor to just use the igraph neighbours object directly
+		igraph_vs_t* neighbours = new igraph_vs_t();
+		igraph_vs_adj(neighbours, v, IGRAPH_IN);
+		igraph_vit_t* neighbours_iterator = new igraph_vit_t();
+		igraph_vit_create(graph->get_igraph(), *neighbours, neighbours_iterator);
+		while (!IGRAPH_VIT_END(*neighbours_iterator)) {
+			neighbour_list->push_back(IGRAPH_VIT_GET(*neighbours_iterator));
+			IGRAPH_VIT_NEXT(*neighbours_iterator);
+		}
+
+		// Clean up neighbours and neighbours_iterator
+		igraph_vit_destroy(neighbours_iterator);
+		delete neighbours_iterator;
+		igraph_vs_destroy(neighbours);
+		delete neighbours;
+	}
+	CROWD_STOP(neighbour_timer);
+	CROWD_COUNT(neighbours, neighbour_list->size());
 
 	// if you have fewer than k neighbours, then you can't hear from at least k
 	if (neighbour_list->size() < k) {
@@ -96,7 +243,9 @@ bool Crowd::is_mk_observer(uint v, ubyte m, ubyte k)
 	map<uint, ptr<vector<ptr<set<uint>>>>> clique_dict; // this will get used to look for cliques
 
 	//we need to get each pair of neighbours
+	CROWD_TIMER(pair_timer, pair_seconds);
 	ptr<vector<ptr<pair<uint, uint>>>> neighbour_pairs = create_pair_list(neighbour_list);
+	CROWD_STOP(pair_timer);
 
 	if (verbose) {
 		cout << "neighbour_pairs of " << v << " are: " << endl;
@@ -111,10 +260,11 @@ bool Crowd::is_mk_observer(uint v, ubyte m, ubyte k)
 		uint b = p->second;
 
 		if (verbose) cout << "Checking pair " << a << "," << b << endl;
+		CROWD_COUNT(pairs_tested, 1);
 
 		// If the shortest path between a and b is less than m, then the nodes aren't m-independent 
-		uint a_path_length = len_shortest_path_excluding_v(a, b, v);
-		uint b_path_length = len_shortest_path_excluding_v(b, a, v);
+		uint a_path_length = len_shortest_path_excluding_v(a, b, v, m);
+		uint b_path_length = len_shortest_path_excluding_v(b, a, v, m);
 		if ((a_path_length < m) || (b_path_length < m)) {
 			continue;
 		}
@@ -122,6 +272,8 @@ bool Crowd::is_mk_observer(uint v, ubyte m, ubyte k)
 		if (k <= 2) {
 			return true;
 		}
+		//the rest of the pair's turn is clique growing
+		CROWD_TIMER(clique_timer, clique_seconds);
 
 		// Now we do the clique updating
 		// First, each pair trivially forms a clique
@@ -156,6 +308,7 @@ bool Crowd::is_mk_observer(uint v, ubyte m, ubyte k)
 		}
 
 		ptr<vector<ptr<pair<ptr<set<uint>>, ptr<set<uint>>>>>> cliques = cartesian_product(clique_dict[a], clique_dict[b]);
+		CROWD_COUNT(clique_candidates, cliques->size());
 		if (verbose) {
 			cout << "Cartesian product of cliques is: " << endl;
 			for (const ptr<pair<ptr<set<uint>>, ptr<set<uint>>>> p2 : *cliques) {
@@ -208,6 +361,7 @@ bool Crowd::is_mk_observer(uint v, ubyte m, ubyte k)
 			}
 			int lenu = node_union->size();
 			if (lenu == (lena + 1)) {
+				CROWD_COUNT(cliques_grown, 1);
 				if (lenu >= k) {  // Early termination
 					return true;
 				}
@@ -250,19 +404,40 @@ ptr<vector<ptr<pair<uint, uint>>>> Crowd::create_pair_list(const ptr<vector<uint
 	return pairs;
 };
 
-uint Crowd::len_shortest_path_excluding_v(uint s, uint t, uint v)
+//cutoff is a hint: paths at least that long may come back as INT_MAX instead of their length
+uint Crowd::len_shortest_path_excluding_v(uint s, uint t, uint v, uint cutoff)
 {
 	//TODO: cache
+	CROWD_COUNT(searches, 1);
+	CROWD_TIMER(search_timer, search_seconds);
+	if (membership != NULL) {
+		return len_shortest_path_in_view(s, t, v, cutoff);
+	}
 
-	// Remove the specified vertex
-	// if you just delete the vertex, then vertex indices will change
-	// so we'll just delete the edges
-	igraph_t* new_graph = new igraph_t();
-	igraph_copy(new_graph, i_graph); // Create a copy of the original graph
 	igraph_vector_int_t edges;
 	igraph_vector_int_init(&edges, 0);
 	igraph_incident(i_graph, &edges, v, IGRAPH_ALL);
-	igraph_delete_edges(new_graph, igraph_ess_vector(&edges));
+
+	// Remove the specified vertex
+	// if you just delete the vertex, then vertex indices will change
+	// so we'll just delete the edges
+	// with weights, deleting edges would also renumber the ones after them and leave the weights misaligned,
+	// so instead we give v's edges an infinite length (which dijkstra ignores) and search the original graph
+	igraph_t* new_graph = NULL;
+	igraph_vector_t* path_weights = weights;
+	igraph_vector_t weights_excluding_v;
+	if (weights != NULL) {
+		igraph_vector_init_copy(&weights_excluding_v, weights);
+		for (igraph_integer_t i = 0; i < igraph_vector_int_size(&edges); i++) {
+			VECTOR(weights_excluding_v)[VECTOR(edges)[i]] = IGRAPH_INFINITY;
+		}
+		path_weights = &weights_excluding_v;
+	} else {
+		new_graph = new igraph_t();
+		igraph_copy(new_graph, i_graph); // Create a copy of the original graph
+		igraph_delete_edges(new_graph, igraph_ess_vector(&edges));
+	}
+	igraph_vector_int_destroy(&edges);
 
 	if (verbose) {
 		//print_graph(new_graph);
@@ -274,11 +449,15 @@ uint Crowd::len_shortest_path_excluding_v(uint s, uint t, uint v)
 	igraph_vs_1(source, s);
 	igraph_vs_t* target = new igraph_vs_t();
 	igraph_vs_1(target, t);
-	igraph_distances_dijkstra(new_graph, igraph_result, *source, *target, weights, IGRAPH_OUT);	//should this be out or all?
+	igraph_distances_dijkstra(new_graph != NULL ? new_graph : i_graph, igraph_result, *source, *target, path_weights, IGRAPH_OUT);	//should this be out or all?
 	igraph_real_t result = igraph_matrix_get(igraph_result, 0, 0);
 	
-	igraph_destroy(new_graph);
-	delete new_graph;
+	if (new_graph != NULL) {
+		igraph_destroy(new_graph);
+		delete new_graph;
+	} else {
+		igraph_vector_destroy(&weights_excluding_v);
+	}
 	igraph_matrix_destroy(igraph_result);
 	delete igraph_result;
 	igraph_vs_destroy(source);
@@ -295,5 +474,52 @@ uint Crowd::len_shortest_path_excluding_v(uint s, uint t, uint v)
 	return result;
 };
 
+//dijkstra over the shared graph that stays inside the view's community and doesn't go through v
+//only the part of the community within cutoff of s gets searched, rather than the whole graph
+uint Crowd::len_shortest_path_in_view(uint s, uint t, uint v, uint cutoff)
+{
+	if (!in_crowd(s) || !in_crowd(t)) {
+		return INT_MAX;
+	}
+	unordered_map<uint, double> distances = { { s, 0 } };
+	priority_queue<pair<double, uint>, vector<pair<double, uint>>, greater<pair<double, uint>>> frontier;
+	frontier.push({ 0, s });
+	igraph_vector_int_t incident;
+	igraph_vector_int_init(&incident, 0);
+	double result = IGRAPH_INFINITY;
+	while (!frontier.empty()) {
+		auto [distance, u] = frontier.top();
+		frontier.pop();
+		if (distance >= cutoff) {
+			break;
+		}
+		if (u == t) {
+			result = distance;
+			break;
+		}
+		if (distance > distances[u]) {
+			continue;	//already reached by a shorter path
+		}
+		CROWD_COUNT(vertices_expanded, 1);
+		igraph_incident(i_graph, &incident, u, IGRAPH_OUT);
+		for (igraph_integer_t i = 0; i < igraph_vector_int_size(&incident); i++) {
+			igraph_integer_t e = VECTOR(incident)[i];
+			igraph_integer_t w = IGRAPH_OTHER(i_graph, e, u);
+			double length = edge_length(e);
+			if (w == v || !in_crowd(w) || length == IGRAPH_INFINITY) {
+				continue;
+			}
+			auto known = distances.find(w);
+			if (known == distances.end() || distance + length < known->second) {
+				distances[w] = distance + length;
+				frontier.push({ distance + length, (uint)w });
+			}
+		}
+	}
+	igraph_vector_int_destroy(&incident);
 
-
+	if (result == IGRAPH_INFINITY) {
+		return INT_MAX;
+	}
+	return result;
+};
@@ -1,6 +1,34 @@
 #pragma once
 #include "utilities.h"
 
+//build Crowd.cpp with POLPOL_CROWD_STATS 1 to count what is_mk_observer does at each stage, and POLPOL_CROWD_TIMERS 1 to time the stages too
+//when they're 0 the counting isn't compiled in at all. the core library leaves them 0; the test and bench projects build
+//their own Crowd.cpp with them on
+#ifndef POLPOL_CROWD_STATS
+#define POLPOL_CROWD_STATS 0
+#endif
+#ifndef POLPOL_CROWD_TIMERS
+#define POLPOL_CROWD_TIMERS 0
+#endif
+
+//where is_mk_observer's work went, stage by stage. all 0 unless counting was compiled in
+struct CrowdStats {
+	uint64_t calls = 0;
+	uint64_t neighbours = 0;	//in-neighbours listed
+	uint64_t pairs_tested = 0;	//neighbour pairs checked for m-independence
+	uint64_t searches = 0;	//shortest path searches
+	uint64_t vertices_expanded = 0;	//by the searches of views - igraph's dijkstra doesn't say
+	uint64_t clique_candidates = 0;	//pairs of cliques compared while growing cliques
+	uint64_t cliques_grown = 0;
+	//only with POLPOL_CROWD_TIMERS
+	double neighbour_seconds = 0;
+	double pair_seconds = 0;
+	double search_seconds = 0;
+	double clique_seconds = 0;
+
+	CrowdStats& operator+=(const CrowdStats& other);
+};
+
 class Crowd
 {
 private:
@@ -12,20 +40,53 @@ private:
 	unsigned char max_m = UCHAR_MAX;
 	string node_key = "T";
 
-	ptr<Graph> graph; //leidenalg graph
+	ptr<Graph> graph; //leidenalg graph - not made for views, which only need the igraph graph
 	igraph_t* i_graph; //igraph graph - this is not a ptr because we need to destroy it manually anyway
+	bool owns_graph = true;	//views over a shared graph leave it alone when they're destroyed
 	igraph_vector_t* weights = NULL;
+	std::vector<bool> edge_in_crowd;	//empty unless the crowd was given edge weights, in which case edges weighted 0 are ignored
+
+	//set for views: only vertices whose membership is community are in the crowd
+	const std::vector<size_t>* membership = NULL;
+	size_t community = 0;
+	const std::vector<double>* view_weights = NULL;	//the caller's edge weights, read in place rather than copied
+	bool weighted_view = false;
 
 	//map<auto, auto> precomputed_path_dict = {}; // "holds unconditional paths" - figure out types later?
 	//map<auto, auto> precomputed_paths_by_hole_node = {}; // "holds dict of paths per node" - figure out types later?
 	ptr<vector<ptr<pair<uint, uint>>>> create_pair_list(const ptr<vector<uint>> list);
-	uint len_shortest_path_excluding_v(uint source, uint target, uint v);
+	//counts go straight into current, which is folded into finished_calls when the next call starts
+	//a crowd is only ever used by one thread at a time, so neither needs to be atomic
+	CrowdStats current;
+	CrowdStats finished_calls;
+
+	uint len_shortest_path_excluding_v(uint source, uint target, uint v, uint cutoff = UINT_MAX);
+	uint len_shortest_path_in_view(uint source, uint target, uint v, uint cutoff);
+	bool in_crowd(igraph_integer_t v) const { return membership == NULL || (*membership)[v] == community; }
+	double edge_length(igraph_integer_t e) const;
 public:
 	const bool verbose = VERBOSE;	//we have a property for this so it can be accessed from the test project
 	Crowd(ptr<Graph> G, bool weighted = false, string node_key = "T");
 	Crowd(igraph_t* i_g, bool weighted = false, string node_key = "T");
+	//edge_weights gives a weight per edge (eg. from weigh_layers), and edges weighted 0 are left out, so one graph can be analysed per layer
+	//if weighted, the weights are used as path lengths, otherwise every edge left in has length 1
+	//throws invalid_argument unless there is exactly one weight per edge
+	Crowd(igraph_t* i_g, const std::vector<double>& edge_weights, bool weighted = false, string node_key = "T");
+	//a view of one community of a graph that belongs to someone else: membership gives each vertex's community, and only the vertices
+	//in community (and the edges between them) are part of the crowd. nothing is copied, and the graph, membership and edge weights
+	//must outlive the view. edge_weights works as above, but is read in place
+	//views only read the graph, so any number of them can share it across threads
+	Crowd(const igraph_t* shared_graph, const std::vector<size_t>& membership, size_t community, const std::vector<double>* edge_weights = NULL, bool weighted = false);
 	~Crowd();
 
 	bool is_mk_observer(uint v, ubyte m, ubyte k);
+
+	//whether this build counts anything (ie. Crowd.cpp was built with POLPOL_CROWD_STATS)
+	static bool counts_stats();
+	//the most recent is_mk_observer call
+	const CrowdStats& last_call_stats() const { return current; }
+	//every call since the crowd was made or reset
+	CrowdStats total_stats() const;
+	void reset_stats();
 };
 
@@ -0,0 +1,135 @@
+#include "Dates.h"
+#include <cstdio>
+#include <stdexcept>
+
+//days since 1970-01-01 for a date in the proleptic gregorian calendar (Howard Hinnant's days_from_civil)
+static int64_t days_from_civil(int64_t y, unsigned m, unsigned d)
+{
+	y -= m <= 2;
+	const int64_t era = (y >= 0 ? y : y - 399) / 400;
+	const unsigned yoe = (unsigned)(y - era * 400);
+	const unsigned doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+	const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+	return era * 146097 + (int64_t)doe - 719468;
+}
+
+//the inverse of days_from_civil
+static void civil_from_days(int64_t z, int64_t& y, unsigned& m, unsigned& d)
+{
+	z += 719468;
+	const int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+	const unsigned doe = (unsigned)(z - era * 146097);
+	const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+	const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+	const unsigned mp = (5 * doy + 2) / 153;
+	d = doy - (153 * mp + 2) / 5 + 1;
+	m = mp < 10 ? mp + 3 : mp - 9;
+	y = (int64_t)yoe + era * 400 + (m <= 2);
+}
+
+int64_t parse_iso_date(std::string_view date)
+{
+	auto invalid = [&date]() {
+		return std::invalid_argument("Invalid date " + std::string(date) + ", expected something like 2020-03-01T00:00:00Z");
+	};
+	size_t position = 0;
+	auto number = [&](size_t length) {
+		int out = 0;
+		for (size_t end = position + length; position < end; position++) {
+			if (position >= date.size() || date[position] < '0' || date[position] > '9') {
+				throw invalid();
+			}
+			out = out * 10 + (date[position] - '0');
+		}
+		return out;
+	};
+	auto expect = [&](char separator) {
+		if (position >= date.size() || date[position] != separator) {
+			throw invalid();
+		}
+		position++;
+	};
+
+	int year = number(4);
+	expect('-');
+	int month = number(2);
+	expect('-');
+	int day = number(2);
+	int hour = 0, minute = 0, second = 0, millisecond = 0;
+	int offset_minutes = 0;	//how far the written time is ahead of UTC
+	if (position < date.size()) {
+		if (date[position] != 'T' && date[position] != ' ') {
+			throw invalid();
+		}
+		position++;
+		hour = number(2);
+		expect(':');
+		minute = number(2);
+		expect(':');
+		second = number(2);
+		if (position < date.size() && date[position] == '.') {
+			position++;
+			//any number of digits, of which only the milliseconds count
+			size_t digits = 0;
+			for (; position < date.size() && date[position] >= '0' && date[position] <= '9'; position++, digits++) {
+				if (digits < 3) {
+					millisecond = millisecond * 10 + (date[position] - '0');
+				}
+			}
+			if (digits == 0) {
+				throw invalid();
+			}
+			for (; digits < 3; digits++) {
+				millisecond *= 10;
+			}
+		}
+		if (position < date.size()) {
+			char zone = date[position++];
+			if (zone == '+' || zone == '-') {
+				int offset_hours = number(2);
+				if (position < date.size() && date[position] == ':') {
+					position++;
+				}
+				int offset_remainder = number(2);
+				if (offset_hours > 23 || offset_remainder > 59) {
+					throw invalid();
+				}
+				offset_minutes = (zone == '-' ? -1 : 1) * (offset_hours * 60 + offset_remainder);
+			} else if (zone != 'Z') {
+				throw invalid();
+			}
+		}
+	}
+	if (position != date.size()) {
+		throw invalid();
+	}
+	int64_t days = month >= 1 && month <= 12 ? days_from_civil(year, month, day) : 0;
+	int64_t days_in_month = month == 12 ? 31 : days_from_civil(year, month + 1, 1) - days_from_civil(year, month, 1);
+	if (month < 1 || month > 12 || day < 1 || day > days_in_month || hour > 23 || minute > 59 || second > 59) {
+		throw invalid();
+	}
+	return ((days * 24 + hour) * 60 + minute - offset_minutes) * 60000LL + second * 1000LL + millisecond;
+};
+
+int64_t utc_milliseconds(const std::tm& time)
+{
+	int64_t days = days_from_civil(time.tm_year + 1900LL, time.tm_mon + 1, time.tm_mday);
+	return ((days * 24 + time.tm_hour) * 60 + time.tm_min) * 60000LL + time.tm_sec * 1000LL;
+};
+
+bsoncxx::types::b_date createBsonDateFromString(const std::string& date_str) {
+	return bsoncxx::types::b_date(std::chrono::milliseconds(parse_iso_date(date_str)));
+}
+
+std::string format_iso_date(int64_t milliseconds)
+{
+	int64_t days = milliseconds >= 0 ? milliseconds / 86400000 : -((-milliseconds + 86399999) / 86400000);
+	int64_t in_day = milliseconds - days * 86400000;
+	int64_t year;
+	unsigned month, day;
+	civil_from_days(days, year, month, day);
+	char buffer[32];
+	snprintf(buffer, sizeof(buffer), "%04lld-%02u-%02uT%02d:%02d:%02dZ", (long long)year, month, day,
+		(int)(in_day / 3600000), (int)(in_day / 60000 % 60), (int)(in_day / 1000 % 60));
+	return buffer;
+};
\ No newline at end of file
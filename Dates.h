@@ -0,0 +1,19 @@
+#pragma once
+#include "utilities.h"
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <string_view>
+#include <bsoncxx/types.hpp>
+
+//dates as milliseconds since the epoch, always in UTC
+//parses an ISO 8601 timestamp to milliseconds since the epoch: 2020-03-01, 2020-03-01T00:00:00 or 2020-03-01 00:00:00,
+//optionally with fractional seconds and a Z or +hh:mm/-hh:mm offset. without an offset it is UTC, never local time
+//throws invalid_argument for anything else, including dates that don't exist
+int64_t parse_iso_date(std::string_view date);
+//the time in a tm (eg. from get_time) as milliseconds since the epoch, reading it as UTC where mktime would read it as local time
+int64_t utc_milliseconds(const std::tm& time);
+//parse_iso_date as a BSON date, eg. "2020-03-01 00:00:00"
+bsoncxx::types::b_date createBsonDateFromString(const std::string& date_str);
+//formats milliseconds since the epoch as 2020-03-01T00:00:00Z (dropping the milliseconds)
+std::string format_iso_date(int64_t milliseconds);
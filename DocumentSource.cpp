@@ -0,0 +1,79 @@
+#include "DocumentSource.h"
+#include <fstream>
+#include <bsoncxx/json.hpp>
+#include <bsoncxx/exception/exception.hpp>
+#include <boost/iostreams/filtering_streambuf.hpp>
+#include <boost/iostreams/filter/gzip.hpp>
+
+using namespace std;
+
+void CursorSource::for_each(const function<void(const bsoncxx::document::view&)>& visit)
+{
+	for (const bsoncxx::document::view doc : *cursor) {
+		visit(doc);
+	}
+};
+
+BsonDumpSource::BsonDumpSource(const string& path) : path(path)
+{
+	file.open(path);
+	if (!file.is_open()) {
+		throw runtime_error("Could not open " + path);
+	}
+};
+
+vector<size_t> BsonDumpSource::document_offsets()
+{
+	vector<size_t> offsets;
+	walk_bson_documents(data(), size(), 0, size(), path, [&offsets](size_t offset, const bsoncxx::document::view&) {
+		offsets.push_back(offset);
+	});
+	return offsets;
+};
+
+void BsonDumpSource::for_each(const function<void(const bsoncxx::document::view&)>& visit)
+{
+	for_each_in(0, size(), visit);
+};
+
+void BsonDumpSource::for_each_in(size_t begin, size_t end, const function<void(const bsoncxx::document::view&)>& visit)
+{
+	walk_bson_documents(data(), size(), begin, end, path, [&visit](size_t, const bsoncxx::document::view& doc) {
+		visit(doc);
+	});
+};
+
+void JsonlSource::for_each(const function<void(const bsoncxx::document::view&)>& visit)
+{
+	ifstream file(path, ios_base::in | ios_base::binary);
+	if (!file) {
+		throw runtime_error("Could not open " + path);
+	}
+	boost::iostreams::filtering_streambuf<boost::iostreams::input> in;
+	if (path.ends_with(".gz")) {
+		in.push(boost::iostreams::gzip_decompressor());
+	}
+	in.push(file);
+	istream stream(&in);
+
+	string line;
+	while (getline(stream, line)) {
+		if (line.empty() || line == "\r") {
+			continue;
+		}
+		try {
+			bsoncxx::document::value doc = bsoncxx::from_json(line);
+			visit(doc.view());
+		} catch (const bsoncxx::exception& e) {
+			cerr << "Could not parse line: " << e.what() << '\n';
+		}
+	}
+};
+
+ptr<DocumentSource> open_document_source(const string& path)
+{
+	if (path.ends_with(".bson")) {
+		return _ptr<BsonDumpSource>(path);
+	}
+	return _ptr<JsonlSource>(path);
+};
@@ -0,0 +1,74 @@
+#pragma once
+#include "utilities.h"
+#include <string>
+#include <cstring>
+#include <bsoncxx/document/view.hpp>
+#include <mongocxx/cursor.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
+
+//calls visit(offset, document) for each of the back to back BSON documents (as in a mongodump file) in data that starts in [begin, end)
+//begin must be the start of a document. throws runtime_error, naming name, if a length prefix doesn't fit in the data
+template<typename Visit>
+void walk_bson_documents(const uint8_t* data, size_t size, size_t begin, size_t end, const std::string& name, Visit visit)
+{
+	size_t offset = begin;
+	while (offset < end && offset + sizeof(int32_t) <= size) {
+		int32_t length;
+		std::memcpy(&length, data + offset, sizeof(int32_t));	//BSON lengths are little endian, as is everything we run on
+		if (length < 5 || offset + length > size) {
+			throw std::runtime_error(name + " is corrupt at byte " + std::to_string(offset));
+		}
+		visit(offset, bsoncxx::document::view(data + offset, length));
+		offset += length;
+	}
+}
+
+//somewhere build_graph can read interaction documents from: a live query, or a local dump when the database isn't reachable
+class DocumentSource
+{
+public:
+	virtual ~DocumentSource() = default;
+	//calls visit with every document in the source. the view is only valid for the duration of the call
+	virtual void for_each(const std::function<void(const bsoncxx::document::view&)>& visit) = 0;
+};
+
+//the results of a MongoDB query
+class CursorSource : public DocumentSource
+{
+private:
+	mongocxx::cursor* cursor;
+public:
+	CursorSource(mongocxx::cursor* cursor) : cursor(cursor) {}
+	void for_each(const std::function<void(const bsoncxx::document::view&)>& visit) override;
+};
+
+//a mongodump .bson file (back to back BSON documents)
+//the file is memory mapped and the views point straight into it, so nothing is copied or allocated per document
+class BsonDumpSource : public DocumentSource
+{
+private:
+	boost::iostreams::mapped_file_source file;
+	std::string path;
+public:
+	BsonDumpSource(const std::string& path);
+	void for_each(const std::function<void(const bsoncxx::document::view&)>& visit) override;
+	//start of each document, for splitting the file between threads
+	std::vector<size_t> document_offsets();
+	//as for_each, but only the documents starting in [begin, end). begin must be the start of a document
+	void for_each_in(size_t begin, size_t end, const std::function<void(const bsoncxx::document::view&)>& visit);
+	const uint8_t* data() const { return reinterpret_cast<const uint8_t*>(file.data()); }
+	size_t size() const { return file.size(); }
+};
+
+//one (extended) JSON document per line, as written by mongoexport. may be gzipped
+class JsonlSource : public DocumentSource
+{
+private:
+	std::string path;
+public:
+	JsonlSource(const std::string& path) : path(path) {}
+	void for_each(const std::function<void(const bsoncxx::document::view&)>& visit) override;
+};
+
+//picks the source type from the file extension (.bson is a dump, anything else is treated as JSON lines)
+ptr<DocumentSource> open_document_source(const std::string& path);
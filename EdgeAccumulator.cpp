@@ -0,0 +1,239 @@
+#include "EdgeAccumulator.h"
+#include "ThreadPool.h"
+
+using namespace std;
+
+EdgeAccumulator::EdgeAccumulator(size_t pending_limit, size_t layer_count) : layer_count(max<size_t>(layer_count, 1)), pending_limit(pending_limit)
+{
+	pending.reserve(min<size_t>(pending_limit, 1 << 16));
+};
+
+void EdgeAccumulator::merge_runs(vector<uint64_t>& keys, vector<uint32_t>& weights, vector<uint32_t>& layer_weights,
+	vector<uint64_t>& other_keys, vector<uint32_t>& other_weights, vector<uint32_t>& other_layer_weights) const
+{
+	if (other_keys.empty()) {
+		return;
+	}
+	if (keys.empty()) {
+		keys = move(other_keys);
+		weights = move(other_weights);
+		layer_weights = move(other_layer_weights);
+		return;
+	}
+	size_t c = columns();
+	size_t a = keys.size();
+	size_t b = other_keys.size();
+	keys.resize(a + b);
+	weights.resize(a + b);
+	layer_weights.resize((a + b) * c);
+	auto move_row = [c](vector<uint32_t>& to, size_t to_row, const vector<uint32_t>& from, size_t from_row) {
+		copy(from.begin() + from_row * c, from.begin() + (from_row + 1) * c, to.begin() + to_row * c);
+	};
+	//merge from the back into the space just added. out never falls below i, so rows are only overwritten once they have been read
+	size_t i = a, j = b, out = a + b;
+	while (j > 0) {
+		out--;
+		if (i > 0 && keys[i - 1] > other_keys[j - 1]) {
+			i--;
+			keys[out] = keys[i];
+			weights[out] = weights[i];
+			move_row(layer_weights, out, layer_weights, i);
+		} else if (i > 0 && keys[i - 1] == other_keys[j - 1]) {
+			i--;
+			j--;
+			keys[out] = keys[i];
+			weights[out] = saturating_add(weights[i], other_weights[j]);
+			for (size_t layer = 0; layer < c; layer++) {
+				layer_weights[out * c + layer] = saturating_add(layer_weights[i * c + layer], other_layer_weights[j * c + layer]);
+			}
+		} else {
+			j--;
+			keys[out] = other_keys[j];
+			weights[out] = other_weights[j];
+			move_row(layer_weights, out, other_layer_weights, j);
+		}
+	}
+	//the first i rows are already in place. edges found in both runs left a gap of out - i rows after them to close up
+	if (out > i) {
+		copy(keys.begin() + out, keys.end(), keys.begin() + i);
+		copy(weights.begin() + out, weights.end(), weights.begin() + i);
+		copy(layer_weights.begin() + out * c, layer_weights.end(), layer_weights.begin() + i * c);
+		size_t merged = a + b - (out - i);
+		keys.resize(merged);
+		weights.resize(merged);
+		layer_weights.resize(merged * c);
+	}
+	other_keys = vector<uint64_t>();
+	other_weights = vector<uint32_t>();
+	other_layer_weights = vector<uint32_t>();
+};
+
+void EdgeAccumulator::add_run()
+{
+	if (pending.empty()) {
+		return;
+	}
+	//every layer's interactions, counted or not, are sorted together, so each edge comes out as one row with all of its layers filled in
+	sort(pending.begin(), pending.end());
+	size_t c = columns();
+	EdgeRun run;
+	for (const PendingInteraction& interaction : pending) {
+		if (run.keys.empty() || run.keys.back() != interaction.key) {
+			run.keys.push_back(interaction.key);
+			run.weights.push_back(0);
+			run.layer_weights.resize(run.layer_weights.size() + c);
+		}
+		run.weights.back() = saturating_add(run.weights.back(), interaction.count);
+		if (c > 0) {
+			uint32_t& layer_weight = run.layer_weights[run.layer_weights.size() - c + interaction.layer];
+			layer_weight = saturating_add(layer_weight, interaction.count);
+		}
+	}
+	pending.clear();
+	runs.push_back(move(run));
+	//merging only runs of similar size keeps the sizes halving from the totals down, so there are O(log edges) runs
+	//and each edge is copied O(log edges) times, rather than once per run as when every run goes straight into the totals
+	while (!runs.empty()) {
+		size_t before = runs.size() > 1 ? runs[runs.size() - 2].keys.size() : edge_keys.size();
+		if (before > 2 * runs.back().keys.size()) {
+			break;
+		}
+		merge_last_run();
+	}
+};
+
+void EdgeAccumulator::merge_last_run()
+{
+	EdgeRun& last = runs.back();
+	if (runs.size() == 1) {
+		merge_runs(edge_keys, edge_weights, edge_layer_weights, last.keys, last.weights, last.layer_weights);
+	} else {
+		EdgeRun& before = runs[runs.size() - 2];
+		merge_runs(before.keys, before.weights, before.layer_weights, last.keys, last.weights, last.layer_weights);
+	}
+	runs.pop_back();
+};
+
+void EdgeAccumulator::compact()
+{
+	add_run();
+	//the runs get smaller towards the back, so merging from the back merges the smallest first
+	while (!runs.empty()) {
+		merge_last_run();
+	}
+};
+
+void EdgeAccumulator::remap(const vector<uint32_t>& mapping)
+{
+	compact();
+	vector<pair<uint64_t, size_t>> remapped(edge_keys.size());
+	max_vertex = 0;
+	for (size_t i = 0; i < edge_keys.size(); i++) {
+		uint32_t new_source = mapping[source(edge_keys[i])];
+		uint32_t new_target = mapping[target(edge_keys[i])];
+		max_vertex = max(max_vertex, max(new_source, new_target));
+		remapped[i] = make_pair(pack(new_source, new_target), i);
+	}
+	//the mapping is one to one, so no two edges can collide, they just need putting back in order
+	sort(remapped.begin(), remapped.end());
+	size_t c = columns();
+	vector<uint32_t> remapped_weights(edge_weights.size());
+	vector<uint32_t> remapped_layer_weights(edge_layer_weights.size());
+	for (size_t i = 0; i < remapped.size(); i++) {
+		size_t from = remapped[i].second;
+		edge_keys[i] = remapped[i].first;
+		remapped_weights[i] = edge_weights[from];
+		copy(edge_layer_weights.begin() + from * c, edge_layer_weights.begin() + (from + 1) * c, remapped_layer_weights.begin() + i * c);
+	}
+	edge_weights = move(remapped_weights);
+	edge_layer_weights = move(remapped_layer_weights);
+};
+
+void EdgeAccumulator::merge(EdgeAccumulator& other)
+{
+	if (other.layer_count != layer_count) {
+		throw invalid_argument("Can't merge edges with " + to_string(other.layer_count) + " layers into edges with " + to_string(layer_count));
+	}
+	compact();
+	other.compact();
+	merge_runs(edge_keys, edge_weights, edge_layer_weights, other.edge_keys, other.edge_weights, other.edge_layer_weights);
+	if (other.has_edges) {
+		max_vertex = max(max_vertex, other.max_vertex);
+		has_edges = true;
+	}
+	other.edge_keys = vector<uint64_t>();
+	other.edge_weights = vector<uint32_t>();
+	other.edge_layer_weights = vector<uint32_t>();
+	other.has_edges = false;
+};
+
+ptr<EdgeAccumulator> EdgeAccumulator::merge_all(vector<ptr<EdgeAccumulator>> accumulators)
+{
+	if (accumulators.empty()) {
+		return _ptr<EdgeAccumulator>();
+	}
+	ThreadPool* pool = ThreadPool::getInstance();
+	//merge neighbours pairwise until there is one left. the order of the merges doesn't affect the result
+	while (accumulators.size() > 1) {
+		vector<future<void>> merges;
+		for (size_t i = 0; i + 1 < accumulators.size(); i += 2) {
+			ptr<EdgeAccumulator> a = accumulators[i];
+			ptr<EdgeAccumulator> b = accumulators[i + 1];
+			merges.push_back(pool->submit([a, b]() { a->merge(*b); }));
+		}
+		for (auto& merge : merges) {
+			merge.get();
+		}
+		vector<ptr<EdgeAccumulator>> remaining;
+		for (size_t i = 0; i < accumulators.size(); i += 2) {
+			remaining.push_back(accumulators[i]);
+		}
+		accumulators = remaining;
+	}
+	accumulators[0]->compact();
+	return accumulators[0];
+};
+
+void EdgeAccumulator::to_igraph(igraph_t* out_graph, igraph_integer_t vertex_count, igraph_vector_t* out_weights, const vector<string>& layer_attributes)
+{
+	compact();
+	igraph_integer_t n = edge_keys.size();
+
+	igraph_vector_int_t edges;
+	igraph_vector_int_init(&edges, 2 * n);
+	for (igraph_integer_t i = 0; i < n; i++) {
+		VECTOR(edges)[2 * i] = source(edge_keys[i]);
+		VECTOR(edges)[2 * i + 1] = target(edge_keys[i]);
+	}
+	edge_keys = vector<uint64_t>();
+
+	igraph_vector_t weights;
+	igraph_vector_init(&weights, n);
+	for (igraph_integer_t i = 0; i < n; i++) {
+		VECTOR(weights)[i] = edge_weights[i];
+	}
+	edge_weights = vector<uint32_t>();
+
+	igraph_create(out_graph, &edges, max<igraph_integer_t>(vertex_count, vertex_count_hint()), IGRAPH_DIRECTED);
+	igraph_vector_int_destroy(&edges);
+	igraph_cattribute_EAN_setv(out_graph, "weight", &weights);
+	if (out_weights != NULL) {
+		igraph_vector_resize(out_weights, n);
+		for (igraph_integer_t i = 0; i < n; i++) {
+			VECTOR(*out_weights)[i] = VECTOR(weights)[i];
+		}
+	}
+	size_t c = columns();
+	if (c > 0 && layer_attributes.size() == layer_count) {
+		for (size_t layer = 0; layer < layer_count; layer++) {
+			for (igraph_integer_t i = 0; i < n; i++) {
+				VECTOR(weights)[i] = edge_layer_weights[i * c + layer];
+			}
+			igraph_cattribute_EAN_setv(out_graph, layer_attributes[layer].c_str(), &weights);
+		}
+	}
+	edge_layer_weights = vector<uint32_t>();
+	igraph_vector_destroy(&weights);
+	has_edges = false;
+	max_vertex = 0;
+};
@@ -0,0 +1,101 @@
+#pragma once
+#include "utilities.h"
+#include <cstdint>
+#include <string>
+
+//collects directed (source, target) interactions and sums duplicates, so the graph can be created straight from the distinct edges
+//interactions are packed into 64 bit keys and buffered; whenever the buffer fills it is sorted and run-length encoded into a run.
+//runs of similar size are merged in place as they arrive, so each edge is copied O(log runs) times and memory stays close to
+//the number of distinct edges rather than the number of interactions
+//the final edges are sorted by (source, target), so the same interactions always produce the same graph whatever order they arrive in
+//interactions can be split into layers (eg. retweets and replies). each edge then also has its interaction count in every layer,
+//aligned with the edges, so one graph can be analysed per layer without building it again
+class EdgeAccumulator
+{
+private:
+	size_t layer_count;
+	//an edge in one layer with some number of interactions, as buffered before compaction
+	struct PendingInteraction {
+		uint64_t key;
+		uint32_t layer;
+		uint32_t count;
+
+		bool operator<(const PendingInteraction& other) const { return key < other.key; }
+	};
+	std::vector<PendingInteraction> pending;	//interactions since the last compaction, every layer's together
+	size_t pending_limit;
+
+	//distinct edges so far, sorted by key, with the number of interactions for each
+	std::vector<uint64_t> edge_keys;
+	std::vector<uint32_t> edge_weights;
+	//with more than one layer, the interactions of each edge per layer: edge_layer_weights[i * layer_count + layer]
+	std::vector<uint32_t> edge_layer_weights;
+	uint32_t max_vertex = 0;
+	bool has_edges = false;
+
+	//a sorted run of edges laid out like the totals above
+	struct EdgeRun {
+		std::vector<uint64_t> keys;
+		std::vector<uint32_t> weights;
+		std::vector<uint32_t> layer_weights;
+	};
+	//runs not yet merged into the totals, each less than half the size of the one before it (the first, of the totals)
+	std::vector<EdgeRun> runs;
+
+	size_t columns() const { return layer_count > 1 ? layer_count : 0; }
+	//sorts the buffered interactions into a run, then merges it with the runs before it while they are of similar size
+	void add_run();
+	//merges the last run into the one before it, or into the totals
+	void merge_last_run();
+	//merges other into keys/weights/layer_weights in place, growing them once. other is left empty
+	void merge_runs(std::vector<uint64_t>& keys, std::vector<uint32_t>& weights, std::vector<uint32_t>& layer_weights,
+		std::vector<uint64_t>& other_keys, std::vector<uint32_t>& other_weights, std::vector<uint32_t>& other_layer_weights) const;
+public:
+	EdgeAccumulator(size_t pending_limit = 1 << 22, size_t layer_count = 1);
+
+	static uint64_t pack(uint32_t source, uint32_t target) { return ((uint64_t)source << 32) | target; }
+	static uint32_t source(uint64_t key) { return (uint32_t)(key >> 32); }
+	static uint32_t target(uint64_t key) { return (uint32_t)key; }
+
+	void add(uint32_t source, uint32_t target, size_t layer = 0) {
+		pending.push_back({ pack(source, target), (uint32_t)layer, 1 });
+		max_vertex = std::max(max_vertex, std::max(source, target));
+		has_edges = true;
+		if (pending.size() >= pending_limit) {
+			add_run();
+		}
+	}
+	//adds count interactions at once, for edges that have already been summed elsewhere (eg. by the database)
+	void add(uint32_t source, uint32_t target, size_t layer, uint32_t count) {
+		if (count == 0) {
+			return;
+		}
+		pending.push_back({ pack(source, target), (uint32_t)layer, count });
+		max_vertex = std::max(max_vertex, std::max(source, target));
+		has_edges = true;
+		if (pending.size() >= pending_limit) {
+			add_run();
+		}
+	}
+	//folds the buffered interactions and every run into the totals. counts that would overflow stop at UINT32_MAX
+	void compact();
+	//renumbers every vertex v as mapping[v]. mapping must not send two vertices to the same place
+	void remap(const std::vector<uint32_t>& mapping);
+	//adds another accumulator's edges into this one (other is left empty). throws invalid_argument if they have different layers
+	void merge(EdgeAccumulator& other);
+	//merges several accumulators into one, pairwise across the thread pool
+	static ptr<EdgeAccumulator> merge_all(std::vector<ptr<EdgeAccumulator>> accumulators);
+
+	size_t edge_count() { compact(); return edge_keys.size(); }
+	size_t vertex_count_hint() const { return has_edges ? (size_t)max_vertex + 1 : 0; }
+	const std::vector<uint64_t>& keys() { compact(); return edge_keys; }
+	const std::vector<uint32_t>& weights() { compact(); return edge_weights; }
+	size_t layers() const { return layer_count; }
+	//the interactions of edge i in each layer are [i * layers(), (i + 1) * layers()). empty with a single layer, where they are just weights()
+	const std::vector<uint32_t>& layer_weights() { compact(); return edge_layer_weights; }
+
+	//creates a directed graph with one edge per distinct (source, target), and sets each edge's "weight" attribute to its number of interactions
+	//with layers, layer_attributes names an edge attribute for each layer's interaction counts
+	//the accumulator's memory is released as the graph is built
+	void to_igraph(igraph_t* out_graph, igraph_integer_t vertex_count, igraph_vector_t* out_weights = NULL, const std::vector<std::string>& layer_attributes = {});
+};
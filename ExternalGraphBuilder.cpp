@@ -0,0 +1,365 @@
+#include "ExternalGraphBuilder.h"
+#include "GraphBuilder.h"
+#include <fstream>
+#include <filesystem>
+#include <queue>
+#include <optional>
+#include <random>
+
+using namespace std;
+
+//the smallest block worth reading or writing at a time, however many runs are open
+static const size_t min_io_block = 1 << 20;
+
+//fixed size records written back to back, a block at a time
+template<typename T>
+class RunWriter
+{
+private:
+	string path;
+	ofstream out;
+	vector<T> block;
+	size_t block_records;
+public:
+	size_t bytes = 0;
+
+	RunWriter(const string& path, size_t block_bytes) : path(path), out(path, ios_base::out | ios_base::binary | ios_base::trunc),
+		block_records(max(block_bytes, min_io_block) / sizeof(T))
+	{
+		if (!out) {
+			throw runtime_error("Could not create run " + path);
+		}
+		block.reserve(block_records);
+	};
+
+	void write(const T& record) {
+		block.push_back(record);
+		if (block.size() == block_records) {
+			flush();
+		}
+	};
+	void flush() {
+		out.write(reinterpret_cast<const char*>(block.data()), block.size() * sizeof(T));
+		bytes += block.size() * sizeof(T);
+		block.clear();
+	};
+	void close() {
+		flush();
+		out.close();
+		if (!out) {
+			throw runtime_error("Could not write run " + path);
+		}
+	};
+};
+
+//reads back what a RunWriter wrote, a block at a time
+template<typename T>
+class RunReader
+{
+private:
+	string path;
+	ifstream in;
+	vector<T> block;
+	size_t block_records;
+	size_t position = 0;
+
+	void fill() {
+		block.resize(block_records);
+		in.read(reinterpret_cast<char*>(block.data()), block_records * sizeof(T));
+		size_t bytes = (size_t)in.gcount();
+		if (bytes % sizeof(T) != 0) {
+			throw runtime_error("Run " + path + " is truncated");
+		}
+		block.resize(bytes / sizeof(T));
+		position = 0;
+	};
+public:
+	RunReader(const string& path, size_t block_bytes) : path(path), in(path, ios_base::in | ios_base::binary),
+		block_records(max(block_bytes, min_io_block) / sizeof(T))
+	{
+		if (!in) {
+			throw runtime_error("Could not open run " + path);
+		}
+		fill();
+	};
+
+	bool done() const { return position == block.size(); }
+	const T& peek() const { return block[position]; }
+	void next() {
+		if (++position == block.size()) {
+			fill();
+		}
+	};
+};
+
+//k-way merge of sorted runs. records that are equal under less are folded together with combine(into, record) and emitted once
+template<typename T, typename Less, typename Combine, typename Emit>
+static void merge_runs(const vector<string>& paths, size_t block_bytes, Less less, Combine combine, Emit emit)
+{
+	vector<unique_ptr<RunReader<T>>> readers;
+	for (const string& path : paths) {
+		readers.push_back(make_unique<RunReader<T>>(path, block_bytes));
+	}
+	auto later = [&readers, &less](size_t a, size_t b) { return less(readers[b]->peek(), readers[a]->peek()); };
+	priority_queue<size_t, vector<size_t>, decltype(later)> heap(later);
+	for (size_t i = 0; i < readers.size(); i++) {
+		if (!readers[i]->done()) {
+			heap.push(i);
+		}
+	}
+	optional<T> current;
+	while (!heap.empty()) {
+		size_t i = heap.top();
+		heap.pop();
+		const T& record = readers[i]->peek();
+		if (current && !less(*current, record)) {
+			combine(*current, record);
+		} else {
+			if (current) {
+				emit(*current);
+			}
+			current = record;
+		}
+		readers[i]->next();
+		if (!readers[i]->done()) {
+			heap.push(i);
+		}
+	}
+	if (current) {
+		emit(*current);
+	}
+}
+
+static void remove_runs(const vector<string>& paths)
+{
+	for (const string& path : paths) {
+		error_code error;
+		filesystem::remove(path, error);
+		if (error) {
+			cerr << "Could not remove run " << path << ": " << error.message() << endl;
+		}
+	}
+}
+
+static auto interaction_less = [](const ExternalGraphBuilder::Interaction& a, const ExternalGraphBuilder::Interaction& b) {
+	return tie(a.user, a.connected_user, a.layer) < tie(b.user, b.connected_user, b.layer);
+};
+static auto interaction_sum = [](ExternalGraphBuilder::Interaction& into, const ExternalGraphBuilder::Interaction& other) {
+	into.count = saturating_add(into.count, other.count);
+};
+static auto user_less = [](uint64_t a, uint64_t b) { return a < b; };
+static auto user_same = [](uint64_t&, uint64_t) {};
+
+ExternalGraphBuilder::ExternalGraphBuilder(const string& directory, size_t memory_budget, size_t merge_fan_in) :
+	directory(directory), memory_budget(memory_budget), merge_fan_in(max<size_t>(merge_fan_in, 2))
+{
+	filesystem::create_directories(directory);
+	//while a run is written, the buffer shares the budget with the user IDs pulled out of it (up to two per interaction)
+	//and the two write blocks
+	size_t buffer_budget = memory_budget > 4 * io_block() ? memory_budget - 2 * io_block() : memory_budget / 2;
+	buffer_limit = max<size_t>(buffer_budget / (sizeof(Interaction) + 2 * sizeof(uint64_t)), 1024);
+	buffer.reserve(min<size_t>(buffer_limit, 1 << 20));
+};
+
+ExternalGraphBuilder::~ExternalGraphBuilder()
+{
+	remove_runs(edge_runs);
+	remove_runs(user_runs);
+	remove_run_directory();
+};
+
+size_t ExternalGraphBuilder::io_block() const
+{
+	//enough for a block from every run of a merge, and one for the output, to stay within the budget
+	return max(memory_budget / (merge_fan_in + 1), min_io_block);
+};
+
+string ExternalGraphBuilder::run_path(const char* kind)
+{
+	if (run_directory.empty()) {
+		//creating a directory either succeeds or finds it already there, so no two builders (in this process or another) end up
+		//with the same one
+		random_device random;
+		filesystem::path candidate;
+		do {
+			candidate = filesystem::path(directory) / ("build-" + to_string(random()));
+		} while (!filesystem::create_directory(candidate));
+		run_directory = candidate.string();
+	}
+	return (filesystem::path(run_directory) / (string(kind) + "-" + to_string(next_run++) + ".run")).string();
+};
+
+void ExternalGraphBuilder::remove_run_directory()
+{
+	if (run_directory.empty()) {
+		return;
+	}
+	error_code error;
+	filesystem::remove(run_directory, error);
+	if (error) {
+		cerr << "Could not remove " << run_directory << ": " << error.message() << endl;
+	}
+	run_directory.clear();
+};
+
+bool ExternalGraphBuilder::add(const bsoncxx::document::view& doc)
+{
+	auto connection_type = doc["connection_type"];
+	InteractionLayer layer = InteractionLayer::Other;
+	if (connection_type && connection_type.type() == bsoncxx::type::k_utf8) {
+		layer = layer_from_connection_type(connection_type.get_string().value);
+	}
+	return add(bsonvalue_to_id(doc["user"]), bsonvalue_to_id(doc["connected_user"]), layer);
+};
+
+bool ExternalGraphBuilder::add(uint64_t user_id, uint64_t connected_user_id, InteractionLayer layer, uint32_t count)
+{
+	if (user_id == connected_user_id || user_id == 0 || connected_user_id == 0 || count == 0) {
+		return false;
+	}
+	buffer.push_back({ user_id, connected_user_id, (uint32_t)layer, count });
+	interactions += count;
+	if (buffer.size() >= buffer_limit) {
+		spill();
+	}
+	return true;
+};
+
+void ExternalGraphBuilder::spill()
+{
+	sort(buffer.begin(), buffer.end(), interaction_less);
+	size_t distinct = 0;
+	for (size_t i = 0; i < buffer.size(); i++) {
+		if (distinct > 0 && !interaction_less(buffer[distinct - 1], buffer[i])) {
+			interaction_sum(buffer[distinct - 1], buffer[i]);
+		} else {
+			buffer[distinct++] = buffer[i];
+		}
+	}
+	buffer.resize(distinct);
+
+	vector<uint64_t> users;
+	users.reserve(2 * distinct);
+	for (const Interaction& interaction : buffer) {
+		users.push_back(interaction.user);
+		users.push_back(interaction.connected_user);
+	}
+	sort(users.begin(), users.end());
+	users.erase(unique(users.begin(), users.end()), users.end());
+
+	string edge_path = run_path("edges");
+	RunWriter<Interaction> edge_writer(edge_path, io_block());
+	edge_runs.push_back(edge_path);
+	for (const Interaction& interaction : buffer) {
+		edge_writer.write(interaction);
+	}
+	edge_writer.close();
+	string user_path = run_path("users");
+	RunWriter<uint64_t> user_writer(user_path, io_block());
+	user_runs.push_back(user_path);
+	for (uint64_t user : users) {
+		user_writer.write(user);
+	}
+	user_writer.close();
+	runs_written += 2;
+	bytes_written += edge_writer.bytes + user_writer.bytes;
+	buffer.clear();
+};
+
+template<typename T, typename Less, typename Combine>
+void ExternalGraphBuilder::reduce_runs(vector<string>& runs, const char* kind, Less less, Combine combine)
+{
+	//each pass merges groups of merge_fan_in runs into one, keeping their order
+	while (runs.size() > merge_fan_in) {
+		size_t count = runs.size();
+		vector<string> merged;
+		for (size_t first = 0; first < count; first += merge_fan_in) {
+			vector<string> group(runs.begin() + first, runs.begin() + min(first + merge_fan_in, count));
+			if (group.size() == 1) {
+				merged.push_back(group[0]);
+				continue;
+			}
+			//the merged run goes on the list before it is written, so if writing it fails the destructor still finds and removes it
+			//along with the rest (removing the runs already merged away again is harmless)
+			string path = run_path(kind);
+			runs.push_back(path);
+			merged.push_back(path);
+			RunWriter<T> writer(path, io_block());
+			merge_runs<T>(group, io_block(), less, combine, [&writer](const T& record) {
+				writer.write(record);
+			});
+			writer.close();
+			runs_written++;
+			bytes_written += writer.bytes;
+			remove_runs(group);
+		}
+		runs = merged;
+	}
+};
+
+void ExternalGraphBuilder::build(igraph_t* out_graph, UserIndex& out_users, igraph_vector_t* out_weights)
+{
+	if (!buffer.empty()) {
+		spill();
+	}
+	buffer = vector<Interaction>();
+
+	//the distinct users, in order, are the vertices
+	reduce_runs<uint64_t>(user_runs, "users", user_less, user_same);
+	merge_runs<uint64_t>(user_runs, memory_budget / (user_runs.size() + 1), user_less, user_same, [&out_users](uint64_t user) {
+		out_users.intern(user);
+	});
+	remove_runs(user_runs);
+	user_runs.clear();
+
+	//the interactions come out of the merge sorted by (user, connected_user, layer), and so with the vertices numbered in user ID order,
+	//the edges come out sorted by (source, target) with each edge's layers next to each other
+	reduce_runs<Interaction>(edge_runs, "edges", interaction_less, interaction_sum);
+	igraph_vector_int_t edges;
+	igraph_vector_int_init(&edges, 0);
+	vector<uint32_t> edge_weights;
+	vector<uint32_t> edge_layer_weights;
+	optional<pair<uint64_t, uint64_t>> last_edge;
+	merge_runs<Interaction>(edge_runs, memory_budget / (edge_runs.size() + 1), interaction_less, interaction_sum, [&](const Interaction& interaction) {
+		pair<uint64_t, uint64_t> edge(interaction.user, interaction.connected_user);
+		if (last_edge != edge) {
+			igraph_vector_int_push_back(&edges, out_users.find(interaction.user));
+			igraph_vector_int_push_back(&edges, out_users.find(interaction.connected_user));
+			edge_weights.push_back(0);
+			edge_layer_weights.resize(edge_layer_weights.size() + interaction_layer_count);
+			last_edge = edge;
+		}
+		edge_weights.back() = saturating_add(edge_weights.back(), interaction.count);
+		uint32_t& layer_weight = edge_layer_weights[edge_layer_weights.size() - interaction_layer_count + interaction.layer];
+		layer_weight = saturating_add(layer_weight, interaction.count);
+	});
+	remove_runs(edge_runs);
+	edge_runs.clear();
+	remove_run_directory();
+
+	igraph_integer_t n = edge_weights.size();
+	igraph_create(out_graph, &edges, out_users.size(), IGRAPH_DIRECTED);
+	igraph_vector_int_destroy(&edges);
+	igraph_vector_t weights;
+	igraph_vector_init(&weights, n);
+	for (igraph_integer_t i = 0; i < n; i++) {
+		VECTOR(weights)[i] = edge_weights[i];
+	}
+	edge_weights = vector<uint32_t>();
+	igraph_cattribute_EAN_setv(out_graph, "weight", &weights);
+	if (out_weights != NULL) {
+		igraph_vector_resize(out_weights, n);
+		for (igraph_integer_t i = 0; i < n; i++) {
+			VECTOR(*out_weights)[i] = VECTOR(weights)[i];
+		}
+	}
+	vector<string> attributes = layer_attributes();
+	for (size_t layer = 0; layer < interaction_layer_count; layer++) {
+		for (igraph_integer_t i = 0; i < n; i++) {
+			VECTOR(weights)[i] = edge_layer_weights[i * interaction_layer_count + layer];
+		}
+		igraph_cattribute_EAN_setv(out_graph, attributes[layer].c_str(), &weights);
+	}
+	igraph_vector_destroy(&weights);
+	interactions = 0;
+};
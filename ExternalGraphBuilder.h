@@ -0,0 +1,70 @@
+#pragma once
+#include "utilities.h"
+#include "UserIndex.h"
+#include "InteractionLayers.h"
+#include <string>
+#include <bsoncxx/document/view.hpp>
+
+//builds the same weighted, layered graph as GraphBuilder from more interactions than fit in memory
+//interactions are buffered up to the memory budget, then sorted by (user, connected_user, layer), summed and written out as a run,
+//along with a run of the sorted distinct user IDs they mention. build() merges the user ID runs to number the vertices, then merges
+//the interaction runs, summing duplicates as it goes, straight into the graph's edge list. there are never more than merge_fan_in
+//runs open at once; beyond that, runs are merged into bigger runs first. every file is written and read front to back in large blocks
+//the budget covers the buffered interactions and the merge buffers; the finished graph and its user IDs still have to fit in memory
+//each builder keeps its runs in a uniquely named subdirectory of the scratch directory, so any number of builds can share it
+//NB: vertex IDs are in user ID order (not in order of first appearance as with GraphBuilder), and no tweet text is kept
+//not thread safe
+class ExternalGraphBuilder
+{
+public:
+	//an edge in one layer, with its number of interactions, as it is stored in the runs
+	struct Interaction {
+		uint64_t user;
+		uint64_t connected_user;
+		uint32_t layer;
+		uint32_t count;
+	};
+private:
+	std::string directory;
+	std::string run_directory;	//this builder's own subdirectory of directory, created with the first run
+	size_t memory_budget;
+	size_t merge_fan_in;	//the most runs merged at once
+	size_t buffer_limit;	//interactions buffered before a run is written
+	std::vector<Interaction> buffer;
+	std::vector<std::string> edge_runs;	//sorted by (user, connected_user, layer), with duplicates summed
+	std::vector<std::string> user_runs;	//sorted distinct user IDs
+	size_t next_run = 0;
+	size_t interactions = 0;
+	size_t runs_written = 0;
+	size_t bytes_written = 0;
+
+	size_t io_block() const;
+	std::string run_path(const char* kind);
+	void remove_run_directory();
+	//sorts and sums the buffer and writes it out as an edge run and a user ID run
+	void spill();
+	//merges runs together until there are no more than merge_fan_in of them
+	template<typename T, typename Less, typename Combine>
+	void reduce_runs(std::vector<std::string>& runs, const char* kind, Less less, Combine combine);
+public:
+	//runs are written under directory, which is created if needed
+	ExternalGraphBuilder(const std::string& directory, size_t memory_budget, size_t merge_fan_in = 64);
+	//removes any runs that are left, and the builder's subdirectory
+	~ExternalGraphBuilder();
+	ExternalGraphBuilder(const ExternalGraphBuilder&) = delete;
+	ExternalGraphBuilder& operator=(const ExternalGraphBuilder&) = delete;
+
+	//returns false if the document isn't a usable interaction (missing users, or a user interacting with themselves)
+	bool add(const bsoncxx::document::view& doc);
+	bool add(uint64_t user_id, uint64_t connected_user_id, InteractionLayer layer = InteractionLayer::Other, uint32_t count = 1);
+
+	size_t interaction_count() const { return interactions; }
+	//runs written so far, including the ones from merge passes
+	size_t run_count() const { return runs_written; }
+	size_t disk_bytes_written() const { return bytes_written; }
+
+	//creates the graph, with the interaction counts in the "weight" edge attribute (and in out_weights if given) and the counts
+	//per layer in the layer_attributes(), and fills out_users (which should be empty) with the users in user ID order
+	//the builder is empty afterwards. throws runtime_error if a run can't be written or read back
+	void build(igraph_t* out_graph, UserIndex& out_users, igraph_vector_t* out_weights = NULL);
+};
@@ -0,0 +1,134 @@
+#include "GraphBuilder.h"
+#include "IdSet.h"
+
+using namespace std;
+
+string_view bson_tweet_text(const bsoncxx::document::view& doc)
+{
+	auto truncated = doc["truncated"];
+	if (truncated && truncated.type() == bsoncxx::type::k_bool && truncated.get_bool().value) {
+		auto extended_tweet = doc["extended_tweet"];
+		if (extended_tweet && extended_tweet.type() == bsoncxx::type::k_document) {
+			auto full_text = extended_tweet.get_document().view()["full_text"];
+			if (full_text && full_text.type() == bsoncxx::type::k_utf8) {
+				return full_text.get_string().value;
+			}
+		}
+	}
+	auto text = doc["text"];
+	if (text && text.type() == bsoncxx::type::k_utf8) {
+		return text.get_string().value;
+	}
+	return string_view();
+};
+
+uint64_t bsonvalue_to_id(bsoncxx::document::element value)
+{
+	if (!value) {
+		return 0;
+	}
+	switch (value.type()) {
+	case bsoncxx::type::k_utf8:
+		return parse_id(value.get_string().value).value_or(0);
+	case bsoncxx::type::k_int64:
+		return value.get_int64().value > 0 ? value.get_int64().value : 0;
+	case bsoncxx::type::k_int32:
+		return value.get_int32().value > 0 ? value.get_int32().value : 0;
+	default:
+		return 0;
+	}
+};
+
+GraphBuilder::GraphBuilder(size_t expected_interactions, TweetStore::Mode text_mode)
+	: GraphBuilder(_ptr<UserIndex>(), _ptr<TweetStore>(text_mode), expected_interactions)
+{
+};
+
+GraphBuilder::GraphBuilder(ptr<UserIndex> users, ptr<TweetStore> tweets, size_t expected_interactions)
+	: users(users), tweets(tweets)
+{
+	//duplicate interactions are summed as they come in, rather than holding every one of them until the end
+	edges = _ptr<EdgeAccumulator>(max<size_t>(min<size_t>(expected_interactions, 1 << 22), 1024), interaction_layer_count);
+};
+
+bool GraphBuilder::add(const bsoncxx::document::view& doc)
+{
+	auto connection_type = doc["connection_type"];
+	InteractionLayer layer = InteractionLayer::Other;
+	if (connection_type && connection_type.type() == bsoncxx::type::k_utf8) {
+		layer = layer_from_connection_type(connection_type.get_string().value);
+	}
+	return add(bsonvalue_to_id(doc["user"]), bsonvalue_to_id(doc["connected_user"]), tweets->keeps_text() ? bson_tweet_text(doc) : string_view(), layer);
+};
+
+bool GraphBuilder::add(uint64_t user_id, uint64_t connected_user_id, string_view text, InteractionLayer layer)
+{
+	if (user_id == connected_user_id || user_id == 0 || connected_user_id == 0) {
+		return false;
+	}
+
+	uint32_t user_vertex = users->intern(user_id);
+	uint32_t connected_user_vertex = users->intern(connected_user_id);
+	tweets->add(user_vertex, text);
+
+	edges->add(user_vertex, connected_user_vertex, (size_t)layer);
+	return true;
+};
+
+bool GraphBuilder::add_group(const bsoncxx::document::view& group)
+{
+	auto id = group["_id"];
+	auto interactions = group["interactions"];
+	if (!id || id.type() != bsoncxx::type::k_document || !interactions) {
+		return false;
+	}
+	bsoncxx::document::view key = id.get_document().view();
+	auto connection_type = key["connection_type"];
+	InteractionLayer layer = InteractionLayer::Other;
+	if (connection_type && connection_type.type() == bsoncxx::type::k_utf8) {
+		layer = layer_from_connection_type(connection_type.get_string().value);
+	}
+	//$sum gives an int32 until it overflows
+	int64_t count = interactions.type() == bsoncxx::type::k_int64 ? interactions.get_int64().value
+		: interactions.type() == bsoncxx::type::k_int32 ? interactions.get_int32().value : 0;
+	if (count <= 0) {
+		return false;
+	}
+	return add_interactions(bsonvalue_to_id(key["user"]), bsonvalue_to_id(key["connected_user"]), layer, (uint32_t)min<int64_t>(count, UINT32_MAX));
+};
+
+bool GraphBuilder::add_interactions(uint64_t user_id, uint64_t connected_user_id, InteractionLayer layer, uint32_t interactions)
+{
+	if (user_id == connected_user_id || user_id == 0 || connected_user_id == 0) {
+		return false;
+	}
+	uint32_t user_vertex = users->intern(user_id);
+	uint32_t connected_user_vertex = users->intern(connected_user_id);
+	edges->add(user_vertex, connected_user_vertex, (size_t)layer, interactions);
+	return true;
+};
+
+ptr<GraphBuilder> GraphBuilder::merge(vector<ptr<GraphBuilder>> parts)
+{
+	ptr<GraphBuilder> merged = _ptr<GraphBuilder>(1 << 20, parts.empty() ? TweetStore::Mode::Plain : parts[0]->tweets->text_mode());
+	vector<ptr<EdgeAccumulator>> accumulators;
+	for (ptr<GraphBuilder> part : parts) {
+		//translate the part's vertex IDs into the merged ones
+		vector<uint32_t> mapping(part->users->size());
+		for (uint32_t v = 0; v < part->users->size(); v++) {
+			mapping[v] = merged->users->intern(part->users->user_id(v));
+		}
+		merged->tweets->append(*part->tweets, mapping);
+		part->tweets = nullptr;
+		part->edges->remap(mapping);
+		accumulators.push_back(part->edges);
+	}
+	merged->edges = EdgeAccumulator::merge_all(accumulators);
+	return merged;
+};
+
+void GraphBuilder::build(igraph_t* out_graph, igraph_vector_t* out_weights)
+{
+	edges->to_igraph(out_graph, users->size(), out_weights, layer_attributes());
+	tweets->seal(users->size());
+};
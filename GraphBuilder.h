@@ -0,0 +1,49 @@
+#pragma once
+#include "utilities.h"
+#include "UserIndex.h"
+#include "EdgeAccumulator.h"
+#include "InteractionLayers.h"
+#include "TweetStore.h"
+#include <string>
+#include <string_view>
+#include <bsoncxx/document/view.hpp>
+#include <bsoncxx/document/element.hpp>
+
+//reads the tweet text from an interaction document, using extended_tweet.full_text for truncated tweets
+//the returned view points into doc
+std::string_view bson_tweet_text(const bsoncxx::document::view& doc);
+//user IDs are stored as strings, but older documents may have them as numbers
+//returns 0 if the element isn't something we can read an ID from
+uint64_t bsonvalue_to_id(bsoncxx::document::element value);
+
+//turns interaction documents (user, connected_user, text) into a graph: one vertex per user, one weighted edge per (user, connected_user)
+//the interactions are also counted per connection_type, so every edge carries its retweet/quote/reply counts as layer attributes
+//not thread safe. to build in parallel, give each thread its own GraphBuilder and merge them at the end
+class GraphBuilder
+{
+public:
+	ptr<UserIndex> users;	//userIDs <-> vertex IDs
+	ptr<EdgeAccumulator> edges;
+	ptr<TweetStore> tweets;	//tweets of each user, indexed by vertex ID. sealed by build()
+
+	GraphBuilder(size_t expected_interactions = 1 << 20, TweetStore::Mode text_mode = TweetStore::Mode::Plain);
+	GraphBuilder(ptr<UserIndex> users, ptr<TweetStore> tweets, size_t expected_interactions = 1 << 20);
+
+	//returns false if the document isn't a usable interaction (missing users, or a user interacting with themselves)
+	bool add(const bsoncxx::document::view& doc);
+	bool add(uint64_t user_id, uint64_t connected_user_id, std::string_view text, InteractionLayer layer = InteractionLayer::Other);
+	//adds a (user, connected_user, connection_type) group counted by the database's $group stage:
+	//{_id: {user, connected_user, connection_type}, interactions: n}. there is no text, so no tweets are added
+	bool add_group(const bsoncxx::document::view& group);
+	bool add_interactions(uint64_t user_id, uint64_t connected_user_id, InteractionLayer layer, uint32_t interactions);
+
+	//combines partial builders, eg. from different time ranges. none of them can have been built yet
+	//vertex IDs are handed out in order of first appearance, taking the parts in the order given, so the result is what one builder
+	//would have produced from the parts' documents read back to back. compared with reading the same documents in any other order
+	//(eg. through one unsorted query) it is the same graph up to vertex renumbering
+	static ptr<GraphBuilder> merge(std::vector<ptr<GraphBuilder>> parts);
+
+	//creates the graph, with the interaction counts in the "weight" edge attribute (and in out_weights if given),
+	//and the counts per layer in the layer_attributes()
+	void build(igraph_t* out_graph, igraph_vector_t* out_weights = NULL);
+};
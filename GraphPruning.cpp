@@ -0,0 +1,161 @@
+#include "GraphPruning.h"
+#include "ThreadPool.h"
+#include "InteractionLayers.h"
+#include <atomic>
+
+using namespace std;
+
+//runs work(begin, end) over [0, n) in chunks across the thread pool, and waits for them all
+static void parallel_ranges(size_t n, const function<void(size_t, size_t)>& work)
+{
+	ThreadPool* pool = ThreadPool::getInstance();
+	size_t chunks = min<size_t>(pool->size() * 4, max<size_t>(n / 4096, 1));
+	if (chunks <= 1) {
+		work(0, n);
+		return;
+	}
+	vector<future<void>> done;
+	for (size_t i = 0; i < chunks; i++) {
+		size_t begin = n * i / chunks;
+		size_t end = n * (i + 1) / chunks;
+		done.push_back(pool->submit([&work, begin, end]() { work(begin, end); }));
+	}
+	for (auto& chunk : done) {
+		chunk.get();
+	}
+};
+
+//copies a numeric edge attribute from graph to out_graph, for the edges that were kept
+static void copy_edge_attribute(const igraph_t* graph, igraph_t* out_graph, const string& name, const vector<igraph_integer_t>& kept_edges)
+{
+	if (!igraph_cattribute_has_attr(graph, IGRAPH_ATTRIBUTE_EDGE, name.c_str())) {
+		return;
+	}
+	igraph_vector_t values;
+	igraph_vector_init(&values, 0);
+	igraph_cattribute_EANV(graph, name.c_str(), igraph_ess_all(IGRAPH_EDGEORDER_ID), &values);
+	igraph_vector_t kept_values;
+	igraph_vector_init(&kept_values, kept_edges.size());
+	for (size_t i = 0; i < kept_edges.size(); i++) {
+		VECTOR(kept_values)[i] = VECTOR(values)[kept_edges[i]];
+	}
+	igraph_cattribute_EAN_setv(out_graph, name.c_str(), &kept_values);
+	igraph_vector_destroy(&values);
+	igraph_vector_destroy(&kept_values);
+};
+
+PruneResult prune_graph(const igraph_t* graph, igraph_t* out_graph, uint32_t min_connections, double min_edge_weight)
+{
+	PruneResult result;
+	size_t vertex_count = igraph_vcount(graph);
+	size_t edge_count = igraph_ecount(graph);
+
+	vector<uint32_t> from(edge_count), to(edge_count);
+	vector<char> edge_kept(edge_count);
+	{
+		igraph_vector_t weights;
+		igraph_vector_init(&weights, 0);
+		bool weighted = igraph_cattribute_has_attr(graph, IGRAPH_ATTRIBUTE_EDGE, "weight");
+		if (weighted) {
+			igraph_cattribute_EANV(graph, "weight", igraph_ess_all(IGRAPH_EDGEORDER_ID), &weights);
+		}
+		parallel_ranges(edge_count, [&](size_t begin, size_t end) {
+			for (size_t e = begin; e < end; e++) {
+				from[e] = IGRAPH_FROM(graph, e);
+				to[e] = IGRAPH_TO(graph, e);
+				edge_kept[e] = from[e] != to[e] && (!weighted || VECTOR(weights)[e] >= min_edge_weight);
+			}
+		});
+		igraph_vector_destroy(&weights);
+	}
+
+	//degree of each vertex over the kept edges, then the edges incident to each vertex (CSR)
+	vector<atomic<uint32_t>> degree(vertex_count);
+	parallel_ranges(edge_count, [&](size_t begin, size_t end) {
+		for (size_t e = begin; e < end; e++) {
+			if (edge_kept[e]) {
+				degree[from[e]].fetch_add(1, memory_order_relaxed);
+				degree[to[e]].fetch_add(1, memory_order_relaxed);
+			}
+		}
+	});
+	vector<uint64_t> incidence_start(vertex_count + 1, 0);
+	for (size_t v = 0; v < vertex_count; v++) {
+		incidence_start[v + 1] = incidence_start[v] + degree[v].load(memory_order_relaxed);
+	}
+	result.light_edges = edge_count - incidence_start[vertex_count] / 2;
+	vector<uint32_t> incidence(incidence_start[vertex_count]);
+	{
+		vector<uint64_t> fill(incidence_start.begin(), incidence_start.end() - 1);
+		for (size_t e = 0; e < edge_count; e++) {
+			if (edge_kept[e]) {
+				incidence[fill[from[e]]++] = (uint32_t)e;
+				incidence[fill[to[e]]++] = (uint32_t)e;
+			}
+		}
+	}
+
+	//peel: each round removes every vertex below the threshold. a removal that takes a neighbour from exactly min_connections
+	//to one less puts it in the next round; that happens once per vertex, so no vertex is queued twice
+	vector<char> removed(vertex_count, 0);
+	vector<uint32_t> frontier;
+	for (size_t v = 0; v < vertex_count; v++) {
+		if (degree[v].load(memory_order_relaxed) < min_connections) {
+			frontier.push_back((uint32_t)v);
+			removed[v] = 1;
+		}
+	}
+	while (!frontier.empty()) {
+		result.peeling_rounds++;
+		mutex next_mutex;
+		vector<uint32_t> next;
+		parallel_ranges(frontier.size(), [&](size_t begin, size_t end) {
+			vector<uint32_t> found;
+			for (size_t i = begin; i < end; i++) {
+				uint32_t v = frontier[i];
+				for (uint64_t j = incidence_start[v]; j < incidence_start[v + 1]; j++) {
+					uint32_t e = incidence[j];
+					uint32_t w = from[e] == v ? to[e] : from[e];
+					if (degree[w].fetch_sub(1, memory_order_relaxed) == min_connections) {
+						found.push_back(w);
+					}
+				}
+			}
+			lock_guard<mutex> lock(next_mutex);
+			next.insert(next.end(), found.begin(), found.end());
+		});
+		for (uint32_t w : next) {
+			removed[w] = 1;
+		}
+		frontier = move(next);
+	}
+
+	//renumber the survivors in their original order, and rebuild the graph from them in one go
+	result.old_to_new.assign(vertex_count, -1);
+	for (size_t v = 0; v < vertex_count; v++) {
+		if (!removed[v]) {
+			result.old_to_new[v] = result.new_to_old.size();
+			result.new_to_old.push_back((uint32_t)v);
+		}
+	}
+	vector<igraph_integer_t> kept_edges;
+	for (size_t e = 0; e < edge_count; e++) {
+		if (edge_kept[e] && !removed[from[e]] && !removed[to[e]]) {
+			kept_edges.push_back(e);
+		}
+	}
+	igraph_vector_int_t edges;
+	igraph_vector_int_init(&edges, 2 * kept_edges.size());
+	for (size_t i = 0; i < kept_edges.size(); i++) {
+		VECTOR(edges)[2 * i] = result.old_to_new[from[kept_edges[i]]];
+		VECTOR(edges)[2 * i + 1] = result.old_to_new[to[kept_edges[i]]];
+	}
+	igraph_create(out_graph, &edges, result.new_to_old.size(), igraph_is_directed(graph));
+	igraph_vector_int_destroy(&edges);
+
+	copy_edge_attribute(graph, out_graph, "weight", kept_edges);
+	for (const string& attribute : layer_attributes()) {
+		copy_edge_attribute(graph, out_graph, attribute, kept_edges);
+	}
+	return result;
+};
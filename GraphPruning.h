@@ -0,0 +1,19 @@
+#pragma once
+#include "utilities.h"
+#include <cstdint>
+
+//what prune_graph kept, and how the vertices were renumbered
+struct PruneResult {
+	std::vector<int64_t> old_to_new;	//new vertex ID of each vertex of the input graph, -1 if it was pruned
+	std::vector<uint32_t> new_to_old;	//input vertex ID of each vertex of the pruned graph
+	size_t light_edges = 0;	//edges dropped for being below min_edge_weight (or self loops)
+	size_t peeling_rounds = 0;
+};
+
+//strips the graph down to its k-core: first edges with a "weight" below min_edge_weight are dropped, then vertices with fewer than
+//min_connections edges (in and out, ignoring self loops) are peeled away, along with their edges, until every vertex left has at least
+//min_connections. this is the same as repeatedly deleting low degree vertices, but each vertex and edge is only visited a constant number of times:
+//every round removes the whole frontier of vertices below the threshold at once, in parallel on the thread pool, and a vertex joins the next
+//frontier exactly when one of those removals takes it below the threshold
+//out_graph is built once from the survivors, numbered in their original order, with the "weight" and layer edge attributes carried over
+PruneResult prune_graph(const igraph_t* graph, igraph_t* out_graph, uint32_t min_connections = 2, double min_edge_weight = 1);
@@ -0,0 +1,162 @@
+#include "GraphSnapshot.h"
+#include "EdgeAccumulator.h"
+#include "InteractionLayers.h"
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <filesystem>
+#include <cstring>
+
+using namespace std;
+
+static const char snapshot_magic[8] = { 'P', 'O', 'L', 'G', 'R', 'A', 'P', 'H' };
+
+uint64_t fnv1a_64(const void* data, size_t length, uint64_t hash)
+{
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	for (size_t i = 0; i < length; i++) {
+		hash ^= bytes[i];
+		hash *= 0x100000001b3ULL;
+	}
+	return hash;
+};
+
+GraphSnapshot::GraphSnapshot(const string& path)
+{
+	file.open(path);
+	if (!file.is_open()) {
+		throw runtime_error("Could not open graph snapshot " + path);
+	}
+	if (file.size() < sizeof(Header)) {
+		throw runtime_error("Graph snapshot " + path + " is truncated");
+	}
+	header = reinterpret_cast<const Header*>(file.data());
+	if (memcmp(header->magic, snapshot_magic, sizeof(snapshot_magic)) != 0) {
+		throw runtime_error(path + " is not a graph snapshot");
+	}
+	if (header->version != format_version) {
+		throw runtime_error("Graph snapshot " + path + " is version " + to_string(header->version) + ", expected " + to_string(format_version));
+	}
+	if (header->layer_count != 0 && header->layer_count != interaction_layer_count) {
+		throw runtime_error("Graph snapshot " + path + " has " + to_string(header->layer_count) + " layers, expected " + to_string(interaction_layer_count));
+	}
+	size_t expected_size = sizeof(Header) + header->vertex_count * sizeof(uint64_t) + header->edge_count * (sizeof(uint64_t) + (1 + header->layer_count) * sizeof(uint32_t));
+	if (file.size() != expected_size) {
+		throw runtime_error("Graph snapshot " + path + " is the wrong size");
+	}
+	const char* payload = file.data() + sizeof(Header);
+	if (fnv1a_64(payload, file.size() - sizeof(Header)) != header->checksum) {
+		throw runtime_error("Graph snapshot " + path + " failed its checksum");
+	}
+	user_id_data = reinterpret_cast<const uint64_t*>(payload);
+	edge_data = user_id_data + header->vertex_count;
+	weight_data = reinterpret_cast<const uint32_t*>(edge_data + header->edge_count);
+	layer_weight_data = weight_data + header->edge_count;
+};
+
+void GraphSnapshot::to_igraph(igraph_t* out_graph) const
+{
+	igraph_integer_t n = edge_count();
+	igraph_vector_int_t edge_list;
+	igraph_vector_int_init(&edge_list, 2 * n);
+	igraph_vector_t weight_vector;
+	igraph_vector_init(&weight_vector, n);
+	for (igraph_integer_t i = 0; i < n; i++) {
+		VECTOR(edge_list)[2 * i] = EdgeAccumulator::source(edge_data[i]);
+		VECTOR(edge_list)[2 * i + 1] = EdgeAccumulator::target(edge_data[i]);
+		VECTOR(weight_vector)[i] = weight_data[i];
+	}
+	igraph_create(out_graph, &edge_list, vertex_count(), IGRAPH_DIRECTED);
+	igraph_cattribute_EAN_setv(out_graph, "weight", &weight_vector);
+	for (size_t layer = 0; layer < layer_count(); layer++) {
+		const uint32_t* column = layer_weights(layer);
+		for (igraph_integer_t i = 0; i < n; i++) {
+			VECTOR(weight_vector)[i] = column[i];
+		}
+		igraph_cattribute_EAN_setv(out_graph, layer_attribute((InteractionLayer)layer).c_str(), &weight_vector);
+	}
+	igraph_vector_int_destroy(&edge_list);
+	igraph_vector_destroy(&weight_vector);
+};
+
+ptr<UserIndex> GraphSnapshot::to_user_index() const
+{
+	ptr<UserIndex> users = _ptr<UserIndex>(vertex_count());
+	for (uint64_t v = 0; v < vertex_count(); v++) {
+		users->intern(user_id_data[v]);
+	}
+	return users;
+};
+
+void GraphSnapshot::save(const string& path, uint64_t query_hash, const igraph_t* graph, const UserIndex& users)
+{
+	Header header = {};
+	memcpy(header.magic, snapshot_magic, sizeof(snapshot_magic));
+	header.version = format_version;
+	header.query_hash = query_hash;
+	header.vertex_count = igraph_vcount(graph);
+	header.edge_count = igraph_ecount(graph);
+	if (header.vertex_count != users.size()) {
+		throw invalid_argument("Graph and user index disagree on the number of vertices");
+	}
+
+	vector<string> attributes = layer_attributes();
+	bool has_layers = all_of(attributes.begin(), attributes.end(), [graph](const string& attribute) {
+		return igraph_cattribute_has_attr(graph, IGRAPH_ATTRIBUTE_EDGE, attribute.c_str());
+	});
+	header.layer_count = has_layers ? (uint32_t)interaction_layer_count : 0;
+
+	//igraph doesn't promise to keep edges in the order we created them, so sort them back into (source, target) order
+	vector<pair<uint64_t, igraph_integer_t>> edges(header.edge_count);
+	for (igraph_integer_t e = 0; e < (igraph_integer_t)header.edge_count; e++) {
+		edges[e] = make_pair(EdgeAccumulator::pack(IGRAPH_FROM(graph, e), IGRAPH_TO(graph, e)), e);
+	}
+	sort(edges.begin(), edges.end());
+	vector<uint64_t> keys(edges.size());
+	for (size_t i = 0; i < edges.size(); i++) {
+		keys[i] = edges[i].first;
+	}
+	//the weights, then each layer's weights, in the sorted edge order
+	vector<uint32_t> counts(edges.size() * (1 + header.layer_count));
+	igraph_vector_t column;
+	igraph_vector_init(&column, 0);
+	for (size_t c = 0; c <= header.layer_count; c++) {
+		string attribute = c == 0 ? "weight" : attributes[c - 1];
+		igraph_cattribute_EANV(graph, attribute.c_str(), igraph_ess_all(IGRAPH_EDGEORDER_ID), &column);
+		for (size_t i = 0; i < edges.size(); i++) {
+			counts[c * edges.size() + i] = (uint32_t)VECTOR(column)[edges[i].second];
+		}
+	}
+	igraph_vector_destroy(&column);
+	edges = vector<pair<uint64_t, igraph_integer_t>>();
+
+	header.checksum = fnv1a_64(users.user_ids().data(), users.size() * sizeof(uint64_t));
+	header.checksum = fnv1a_64(keys.data(), keys.size() * sizeof(uint64_t), header.checksum);
+	header.checksum = fnv1a_64(counts.data(), counts.size() * sizeof(uint32_t), header.checksum);
+
+	//written under a temporary name and renamed, so a half written snapshot is never picked up
+	filesystem::path final_path(path);
+	if (final_path.has_parent_path()) {
+		filesystem::create_directories(final_path.parent_path());
+	}
+	string temp_path = path + ".tmp";
+	{
+		ofstream out(temp_path, ios_base::out | ios_base::binary | ios_base::trunc);
+		out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		out.write(reinterpret_cast<const char*>(users.user_ids().data()), users.size() * sizeof(uint64_t));
+		out.write(reinterpret_cast<const char*>(keys.data()), keys.size() * sizeof(uint64_t));
+		out.write(reinterpret_cast<const char*>(counts.data()), counts.size() * sizeof(uint32_t));
+		out.close();
+		if (!out) {
+			throw runtime_error("Could not write graph snapshot " + temp_path);
+		}
+	}
+	filesystem::rename(temp_path, path);
+};
+
+string GraphSnapshot::path_for(const string& directory, uint64_t query_hash)
+{
+	stringstream name;
+	name << "graph-" << hex << setw(16) << setfill('0') << query_hash << ".polgraph";
+	return (filesystem::path(directory) / name.str()).string();
+};
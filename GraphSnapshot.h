@@ -0,0 +1,62 @@
+#pragma once
+#include "utilities.h"
+#include "UserIndex.h"
+#include <string>
+#include <boost/iostreams/device/mapped_file.hpp>
+
+//64 bit FNV-1a, used for the snapshot checksum and for keying snapshots by query
+uint64_t fnv1a_64(const void* data, size_t length, uint64_t hash = 0xcbf29ce484222325ULL);
+
+//a built graph saved to disk, so re-running the same query doesn't have to go back to the database
+//file layout (all little endian):
+//	header
+//	user IDs			uint64[vertex_count]	vertex ID -> user ID
+//	edges				uint64[edge_count]		(source << 32) | target, sorted
+//	weights				uint32[edge_count]		number of interactions on each edge
+//	layer weights		uint32[layer_count][edge_count]	number of interactions of each layer on each edge (see InteractionLayers.h)
+//the checksum covers everything after the header
+class GraphSnapshot
+{
+public:
+	static const uint32_t format_version = 2;
+
+	struct Header {
+		char magic[8];
+		uint32_t version;
+		uint32_t layer_count;	//0 if the graph was saved without layers
+		uint64_t query_hash;
+		uint64_t vertex_count;
+		uint64_t edge_count;
+		uint64_t checksum;
+	};
+private:
+	boost::iostreams::mapped_file_source file;
+	const Header* header = NULL;
+	const uint64_t* user_id_data = NULL;
+	const uint64_t* edge_data = NULL;
+	const uint32_t* weight_data = NULL;
+	const uint32_t* layer_weight_data = NULL;
+public:
+	//maps the file and checks it. throws if it is missing, corrupt or from a different format version
+	GraphSnapshot(const std::string& path);
+
+	uint64_t query_hash() const { return header->query_hash; }
+	uint64_t vertex_count() const { return header->vertex_count; }
+	uint64_t edge_count() const { return header->edge_count; }
+	const uint64_t* user_ids() const { return user_id_data; }
+	const uint64_t* edges() const { return edge_data; }
+	const uint32_t* weights() const { return weight_data; }
+	uint32_t layer_count() const { return header->layer_count; }
+	//the interaction counts of one layer, for every edge
+	const uint32_t* layer_weights(size_t layer) const { return layer_weight_data + layer * header->edge_count; }
+
+	//creates the directed graph, with the interaction counts in the "weight" edge attribute, and the layer attributes if it has layers
+	void to_igraph(igraph_t* out_graph) const;
+	ptr<UserIndex> to_user_index() const;
+
+	//saves graph (which must have a "weight" edge attribute) and its vertex -> user ID mapping
+	//the layer attributes are saved too, if the graph has them
+	static void save(const std::string& path, uint64_t query_hash, const igraph_t* graph, const UserIndex& users);
+	//where the snapshot for a query lives in directory
+	static std::string path_for(const std::string& directory, uint64_t query_hash);
+};
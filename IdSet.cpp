@@ -0,0 +1,57 @@
+#include "IdSet.h"
+#include <charconv>
+
+using namespace std;
+
+optional<uint64_t> parse_id(string_view id_str)
+{
+	uint64_t id = 0;
+	auto [end, error] = from_chars(id_str.data(), id_str.data() + id_str.size(), id);
+	if (error != errc() || end != id_str.data() + id_str.size() || id == 0) {
+		return nullopt;
+	}
+	return id;
+};
+
+size_t ConcurrentIdSet::shard_for(uint64_t id)
+{
+	return hash_id(id) & (shard_count - 1);
+};
+
+bool ConcurrentIdSet::insert(uint64_t id)
+{
+	Shard& shard = shards[shard_for(id)];
+	bool inserted;
+	{
+		lock_guard<mutex> guard(shard.lock);
+		inserted = shard.ids.insert(id).second;
+	}
+	if (inserted) {
+		count++;
+	}
+	return inserted;
+};
+
+bool ConcurrentIdSet::contains(uint64_t id)
+{
+	Shard& shard = shards[shard_for(id)];
+	lock_guard<mutex> guard(shard.lock);
+	return shard.ids.find(id) != shard.ids.end();
+};
+
+void ConcurrentIdSet::reserve(size_t expected_ids)
+{
+	for (Shard& shard : shards) {
+		lock_guard<mutex> guard(shard.lock);
+		shard.ids.reserve(expected_ids / shard_count + 1);
+	}
+};
+
+void ConcurrentIdSet::clear()
+{
+	for (Shard& shard : shards) {
+		lock_guard<mutex> guard(shard.lock);
+		shard.ids.clear();
+	}
+	count = 0;
+};
@@ -0,0 +1,53 @@
+#pragma once
+#include "utilities.h"
+#include <mutex>
+#include <atomic>
+#include <string_view>
+#include <optional>
+#include <unordered_set>
+
+//parses a twitter id_str into a 64 bit integer
+//returns nullopt if the string isn't a valid id. twitter never issues an id of 0, so "0" isn't one either
+std::optional<uint64_t> parse_id(std::string_view id_str);
+
+//mixes the bits of an id so it can be used directly as a hash
+//twitter ids are snowflakes, so the low bits are a per-machine sequence number and not evenly spread (splitmix64 finaliser)
+inline uint64_t hash_id(uint64_t id)
+{
+	id ^= id >> 30;
+	id *= 0xbf58476d1ce4e5b9ULL;
+	id ^= id >> 27;
+	id *= 0x94d049bb133111ebULL;
+	id ^= id >> 31;
+	return id;
+}
+
+//set of 64 bit tweet/user IDs that can be shared by several parser threads
+//IDs are spread over independently locked shards, so threads only contend when they hit the same shard at the same time
+class ConcurrentIdSet
+{
+private:
+	static const size_t shard_count = 64;	//power of two so we can mask instead of mod
+
+	//aligned so that two shards never share a cache line
+	struct alignas(64) Shard {
+		std::mutex lock;
+		std::unordered_set<uint64_t> ids;
+	};
+	Shard shards[shard_count];
+	std::atomic<size_t> count = 0;
+
+	static size_t shard_for(uint64_t id);
+public:
+	ConcurrentIdSet() = default;
+	ConcurrentIdSet(const ConcurrentIdSet&) = delete;
+	ConcurrentIdSet& operator=(const ConcurrentIdSet&) = delete;
+
+	//returns true if the id was not already in the set, ie. the caller is the first to see it and should process it
+	bool insert(uint64_t id);
+	bool contains(uint64_t id);
+	size_t size() const { return count; }
+	//pre-sizes every shard so the sets don't rehash while the parsers are running
+	void reserve(size_t expected_ids);
+	void clear();
+};
@@ -0,0 +1,90 @@
+#include "InteractionLayers.h"
+
+using namespace std;
+
+static const char* layer_names[interaction_layer_count] = { "retweet", "quote", "reply", "other" };
+
+InteractionLayer layer_from_connection_type(string_view connection_type)
+{
+	for (size_t layer = 0; layer < interaction_layer_count; layer++) {
+		if (connection_type == layer_names[layer]) {
+			return (InteractionLayer)layer;
+		}
+	}
+	return InteractionLayer::Other;
+};
+
+const char* layer_name(InteractionLayer layer)
+{
+	return layer_names[(size_t)layer];
+};
+
+string layer_attribute(InteractionLayer layer)
+{
+	return string("weight_") + layer_name(layer);
+};
+
+vector<string> layer_attributes()
+{
+	vector<string> attributes;
+	for (size_t layer = 0; layer < interaction_layer_count; layer++) {
+		attributes.push_back(layer_attribute((InteractionLayer)layer));
+	}
+	return attributes;
+};
+
+layer_weighting all_layers()
+{
+	layer_weighting weighting;
+	weighting.fill(1);
+	return weighting;
+};
+
+layer_weighting parse_layer_weighting(string_view spec)
+{
+	layer_weighting weighting = {};
+	while (!spec.empty()) {
+		size_t comma = spec.find(',');
+		string_view item = spec.substr(0, comma);
+		spec = comma == string_view::npos ? string_view() : spec.substr(comma + 1);
+		if (item.empty()) {
+			continue;
+		}
+		size_t equals = item.find('=');
+		string_view name = item.substr(0, equals);
+		double factor = 1;
+		if (equals != string_view::npos) {
+			factor = stod(string(item.substr(equals + 1)));
+		}
+		InteractionLayer layer = layer_from_connection_type(name);
+		if (layer == InteractionLayer::Other && name != layer_name(InteractionLayer::Other)) {
+			throw invalid_argument("Unknown interaction layer: " + string(name));
+		}
+		weighting[(size_t)layer] = factor;
+	}
+	return weighting;
+};
+
+vector<double> weigh_layers(const igraph_t* graph, const layer_weighting& weighting)
+{
+	igraph_integer_t n = igraph_ecount(graph);
+	vector<double> weights(n, 0.0);
+	igraph_vector_t column;
+	igraph_vector_init(&column, 0);
+	for (size_t layer = 0; layer < interaction_layer_count; layer++) {
+		if (weighting[layer] == 0) {
+			continue;
+		}
+		string attribute = layer_attribute((InteractionLayer)layer);
+		if (!igraph_cattribute_has_attr(graph, IGRAPH_ATTRIBUTE_EDGE, attribute.c_str())) {
+			igraph_vector_destroy(&column);
+			throw invalid_argument("The graph has no " + attribute + " attribute. Was it built with layers?");
+		}
+		igraph_cattribute_EANV(graph, attribute.c_str(), igraph_ess_all(IGRAPH_EDGEORDER_ID), &column);
+		for (igraph_integer_t e = 0; e < n; e++) {
+			weights[e] += weighting[layer] * VECTOR(column)[e];
+		}
+	}
+	igraph_vector_destroy(&column);
+	return weights;
+};
@@ -0,0 +1,32 @@
+#pragma once
+#include "utilities.h"
+#include <array>
+#include <string>
+#include <string_view>
+
+//the kinds of interaction parse_tweet records in connection_type. each is a layer of the multiplex graph,
+//with its interaction counts in an edge attribute alongside the combined "weight"
+enum class InteractionLayer : uint8_t { Retweet, Quote, Reply, Other };
+const size_t interaction_layer_count = 4;
+
+//how much each layer counts towards an edge's weight. a layer weighted 0 is left out entirely
+using layer_weighting = std::array<double, interaction_layer_count>;
+
+//interactions without a recognised connection_type go in the Other layer
+InteractionLayer layer_from_connection_type(std::string_view connection_type);
+//"retweet", "quote", "reply", "other"
+const char* layer_name(InteractionLayer layer);
+//the edge attribute holding a layer's interaction counts, eg. "weight_retweet"
+std::string layer_attribute(InteractionLayer layer);
+std::vector<std::string> layer_attributes();
+
+//every layer counted once, ie. the combined "weight"
+layer_weighting all_layers();
+//parses a comma separated list of layers, each optionally with a factor: "retweet,reply" or "retweet=1,quote=0.5"
+//layers not listed are weighted 0. throws invalid_argument for unknown layers
+layer_weighting parse_layer_weighting(std::string_view spec);
+
+//the weight of each edge (in edge ID order) under weighting, computed from the graph's layer attributes without copying the graph
+//edges whose weight comes out as 0 are effectively not in the graph
+//throws invalid_argument if the graph wasn't built with layers
+std::vector<double> weigh_layers(const igraph_t* graph, const layer_weighting& weighting);
@@ -0,0 +1,220 @@
+#include "Profiler.h"
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <boost/json.hpp>
+
+using namespace std;
+
+#ifndef POLPOL_NO_ALLOCATION_COUNTS
+//off unless count_allocations turns it on. while off, operator new only reads this flag, which nothing writes meanwhile
+static atomic<bool> counting{ false };
+
+//each thread counts into one of these, so threads allocating at the same time don't all contend for one cache line
+//the totals are summed over the slots when they are read
+struct alignas(64) AllocationSlot {
+	atomic<uint64_t> allocations{ 0 };
+	atomic<uint64_t> bytes{ 0 };
+};
+static constexpr size_t slot_count = 64;
+static AllocationSlot slots[slot_count];
+static atomic<size_t> next_slot{ 0 };
+static thread_local size_t thread_slot = slot_count;
+
+//relaxed, since the counts are only ever read as a total
+static void* counted_allocation(size_t size)
+{
+	if (counting.load(memory_order_relaxed)) {
+		if (thread_slot == slot_count) {
+			thread_slot = next_slot.fetch_add(1, memory_order_relaxed) % slot_count;
+		}
+		slots[thread_slot].allocations.fetch_add(1, memory_order_relaxed);
+		slots[thread_slot].bytes.fetch_add(size, memory_order_relaxed);
+	}
+	void* memory = malloc(size == 0 ? 1 : size);
+	if (memory == NULL) {
+		throw bad_alloc();
+	}
+	return memory;
+}
+
+void* operator new(size_t size) { return counted_allocation(size); }
+void* operator new[](size_t size) { return counted_allocation(size); }
+void operator delete(void* memory) noexcept { free(memory); }
+void operator delete[](void* memory) noexcept { free(memory); }
+void operator delete(void* memory, size_t) noexcept { free(memory); }
+void operator delete[](void* memory, size_t) noexcept { free(memory); }
+
+void count_allocations(bool enabled) { counting.store(enabled, memory_order_relaxed); }
+
+uint64_t allocation_count()
+{
+	uint64_t total = 0;
+	for (const AllocationSlot& slot : slots) {
+		total += slot.allocations.load(memory_order_relaxed);
+	}
+	return total;
+}
+
+uint64_t allocated_bytes()
+{
+	uint64_t total = 0;
+	for (const AllocationSlot& slot : slots) {
+		total += slot.bytes.load(memory_order_relaxed);
+	}
+	return total;
+}
+#else
+void count_allocations(bool) {}
+uint64_t allocation_count() { return 0; }
+uint64_t allocated_bytes() { return 0; }
+#endif
+
+#ifdef _WIN32
+size_t current_rss()
+{
+	PROCESS_MEMORY_COUNTERS counters;
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+		return 0;
+	}
+	return counters.WorkingSetSize;
+}
+
+size_t peak_rss()
+{
+	PROCESS_MEMORY_COUNTERS counters;
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+		return 0;
+	}
+	return counters.PeakWorkingSetSize;
+}
+#else
+//reads a "Name:   1234 kB" line of /proc/self/status
+static size_t proc_status_bytes(const string& name)
+{
+	ifstream status("/proc/self/status");
+	string line;
+	while (getline(status, line)) {
+		if (line.compare(0, name.size(), name) == 0 && line.size() > name.size() && line[name.size()] == ':') {
+			return stoull(line.substr(name.size() + 1)) * 1024;
+		}
+	}
+	return 0;
+}
+
+size_t current_rss() { return proc_status_bytes("VmRSS"); }
+size_t peak_rss() { return proc_status_bytes("VmHWM"); }
+#endif
+
+//phases open on this thread, for the depth of nested ones
+static thread_local size_t open_phases = 0;
+
+Profiler::Phase::Phase(const string& name)
+{
+	profile.name = name;
+	profile.depth = open_phases++;
+	profile.rss_before = current_rss();
+	profile.allocations = allocation_count();
+	profile.allocated_bytes = allocated_bytes();
+	started = chrono::steady_clock::now();
+	profile.start = Profiler::getInstance()->since_start(started);
+}
+
+Profiler::Phase::~Phase()
+{
+	open_phases--;
+	profile.seconds = elapsed();
+	//allocations first, reading /proc allocates too
+	profile.allocations = allocation_count() - profile.allocations;
+	profile.allocated_bytes = allocated_bytes() - profile.allocated_bytes;
+	profile.rss_after = current_rss();
+	profile.peak_rss = peak_rss();
+	cout << profile.name << " took " << profile.seconds << " seconds (memory " << profile.rss_after / 1024 / 1024 << "MB, peak "
+		<< profile.peak_rss / 1024 / 1024 << "MB, " << profile.allocations << " allocations)" << endl;
+	Profiler::getInstance()->record(move(profile));
+}
+
+double Profiler::Phase::elapsed() const
+{
+	return chrono::duration<double>(chrono::steady_clock::now() - started).count();
+}
+
+void Profiler::note(const string& key, const string& value)
+{
+	lock_guard<std::mutex> lock(mutex);
+	notes[key] = value;
+}
+
+vector<PhaseProfile> Profiler::phases() const
+{
+	vector<PhaseProfile> ordered;
+	{
+		lock_guard<std::mutex> lock(mutex);
+		ordered = finished;
+	}
+	stable_sort(ordered.begin(), ordered.end(), [](const PhaseProfile& a, const PhaseProfile& b) {
+		return a.start < b.start;
+	});
+	return ordered;
+}
+
+void Profiler::write_json(const string& path) const
+{
+	boost::json::object run_notes;
+	{
+		lock_guard<std::mutex> lock(mutex);
+		for (const auto& [key, value] : notes) {
+			run_notes[key] = value;
+		}
+	}
+	boost::json::array phase_list;
+	for (const PhaseProfile& phase : phases()) {
+		boost::json::object entry;
+		entry["name"] = phase.name;
+		entry["depth"] = phase.depth;
+		entry["start"] = phase.start;
+		entry["seconds"] = phase.seconds;
+		entry["rss_before"] = phase.rss_before;
+		entry["rss_after"] = phase.rss_after;
+		entry["peak_rss"] = phase.peak_rss;
+		entry["allocations"] = phase.allocations;
+		entry["allocated_bytes"] = phase.allocated_bytes;
+		phase_list.push_back(move(entry));
+	}
+	boost::json::object report;
+	report["notes"] = run_notes;
+	report["seconds"] = since_start(chrono::steady_clock::now());
+	report["peak_rss"] = peak_rss();
+	report["allocations"] = allocation_count();
+	report["allocated_bytes"] = allocated_bytes();
+	report["phases"] = phase_list;
+
+	ofstream out(path, ios_base::out | ios_base::trunc);
+	out << boost::json::serialize(report);
+	out.close();
+	if (!out) {
+		throw runtime_error("Could not write profile " + path);
+	}
+}
+
+void Profiler::record(PhaseProfile&& profile)
+{
+	lock_guard<std::mutex> lock(mutex);
+	finished.push_back(move(profile));
+}
+
+double Profiler::since_start(chrono::steady_clock::time_point time) const
+{
+	return chrono::duration<double>(time - created).count();
+}
+
+ProfileReport::~ProfileReport()
+{
+	try {
+		Profiler::getInstance()->write_json(path);
+		cout << "Profile written to " << path << endl;
+	} catch (const exception& e) {
+		cerr << e.what() << endl;
+	}
+}
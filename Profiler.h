@@ -0,0 +1,89 @@
+#pragma once
+#include "utilities.h"
+#include <string>
+#include <map>
+#include <mutex>
+
+//resident memory of this process in bytes, from /proc/self/status on linux and the process counters on windows
+//0 if the platform doesn't say
+size_t current_rss();
+size_t peak_rss();
+
+//allocations made through operator new while counting was on, by every thread
+//counting replaces the global operator new, and is off until count_allocations(true) (POLPOL_ALLOCATION_COUNTS for a run)
+//define POLPOL_NO_ALLOCATION_COUNTS to build without it, and these stay 0
+//over-aligned allocations (operator new with align_val_t) go to the standard library and aren't counted
+void count_allocations(bool enabled);
+uint64_t allocation_count();
+uint64_t allocated_bytes();
+
+//one finished phase of a run
+struct PhaseProfile {
+	std::string name;
+	size_t depth = 0;	//how many phases it was nested in, on the thread that ran it
+	double start = 0;	//seconds since the profiler started
+	double seconds = 0;
+	size_t rss_before = 0;
+	size_t rss_after = 0;
+	size_t peak_rss = 0;	//of the process so far, as of the end of the phase
+	uint64_t allocations = 0;	//during the phase, including those made by other threads meanwhile. 0 unless counting is on
+	uint64_t allocated_bytes = 0;
+};
+
+//collects how long each phase of a run takes and what it costs in memory, for a report at the end
+class Profiler
+{
+public:
+	Profiler(const Profiler&) = delete;
+	Profiler& operator=(const Profiler&) = delete;
+
+	static Profiler* getInstance() {
+		static Profiler* instance;
+		if (instance == nullptr) {
+			instance = new Profiler();
+		}
+		return instance;
+	}
+
+	//times everything from its construction to its destruction as the named phase, and prints what it took when it ends
+	//phases can nest, and can run on any thread
+	class Phase
+	{
+	public:
+		Phase(const std::string& name);
+		~Phase();
+		Phase(const Phase&) = delete;
+		Phase& operator=(const Phase&) = delete;
+		double elapsed() const;
+	private:
+		PhaseProfile profile;
+		std::chrono::steady_clock::time_point started;
+	};
+
+	//extra facts about the run (mode, thread count...) to go in the report
+	void note(const std::string& key, const std::string& value);
+	//finished phases, in the order they started
+	std::vector<PhaseProfile> phases() const;
+	//{"notes": {...}, "seconds": ..., "peak_rss": ..., "allocations": ..., "allocated_bytes": ..., "phases": [{...}, ...]}
+	void write_json(const std::string& path) const;
+
+private:
+	mutable std::mutex mutex;
+	std::vector<PhaseProfile> finished;
+	std::map<std::string, std::string> notes;
+	std::chrono::steady_clock::time_point created = std::chrono::steady_clock::now();
+
+	Profiler() {}
+	void record(PhaseProfile&& profile);
+	double since_start(std::chrono::steady_clock::time_point time) const;
+};
+
+//writes the profiler's report to path when it goes out of scope, so every way out of a run leaves one behind
+class ProfileReport
+{
+private:
+	std::string path;
+public:
+	ProfileReport(const std::string& path) : path(path) {}
+	~ProfileReport();
+};
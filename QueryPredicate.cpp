@@ -0,0 +1,235 @@
+#include "QueryPredicate.h"
+#include "Dates.h"
+#include <fstream>
+#include <sstream>
+
+using namespace std;
+
+QueryPredicate::QueryPredicate(const boost::json::value& filter)
+{
+	if (!filter.is_object()) {
+		throw invalid_argument("Query filter must be an object");
+	}
+	root = compile_document(filter.as_object());
+};
+
+QueryPredicate QueryPredicate::from_file(const string& path)
+{
+	ifstream in(path);
+	if (!in) {
+		throw runtime_error("Could not open " + path);
+	}
+	stringstream contents;
+	contents << in.rdbuf();
+	return QueryPredicate(boost::json::parse(contents.str()));
+};
+
+QueryPredicate::Node QueryPredicate::compile_document(const boost::json::object& filter)
+{
+	//every top level key has to match, so a document is an implicit $and
+	Node node;
+	node.op = Op::And;
+	for (const auto& [key, value] : filter) {
+		if (key == "$and" || key == "$or") {
+			Node group;
+			group.op = key == "$and" ? Op::And : Op::Or;
+			for (const auto& clause : value.as_array()) {
+				group.children.push_back(compile_document(clause.as_object()));
+			}
+			node.children.push_back(move(group));
+		} else if (key.starts_with("$")) {
+			throw invalid_argument("Unsupported query operator " + string(key));
+		} else {
+			node.children.push_back(compile_field(string(key), value));
+		}
+	}
+	return node;
+};
+
+QueryPredicate::Node QueryPredicate::compile_field(const string& field, const boost::json::value& condition)
+{
+	vector<string> path;
+	stringstream parts(field);
+	string part;
+	while (getline(parts, part, '.')) {
+		path.push_back(part);
+	}
+
+	//{"field": value} is shorthand for {"field": {"$eq": value}}, unless value is an operator document
+	bool is_operator_document = condition.is_object() && !condition.as_object().empty() &&
+		condition.as_object().begin()->key().starts_with("$") && !condition.as_object().contains("$date");
+	if (!is_operator_document) {
+		Node node;
+		node.op = Op::Eq;
+		node.path = path;
+		node.operand = compile_operand(condition);
+		return node;
+	}
+
+	Node node;
+	node.op = Op::And;
+	for (const auto& [op, value] : condition.as_object()) {
+		Node comparison;
+		comparison.path = path;
+		if (op == "$eq") comparison.op = Op::Eq;
+		else if (op == "$ne") comparison.op = Op::Ne;
+		else if (op == "$exists") comparison.op = Op::Exists;
+		else if (op == "$gt") comparison.op = Op::Gt;
+		else if (op == "$gte") comparison.op = Op::Gte;
+		else if (op == "$lt") comparison.op = Op::Lt;
+		else if (op == "$lte") comparison.op = Op::Lte;
+		else throw invalid_argument("Unsupported query operator " + string(op));
+
+		if (comparison.op == Op::Exists) {
+			//query.json has "$exists": "true", so accept the string forms as well
+			comparison.operand.kind = Operand::Kind::Bool;
+			if (value.is_bool()) {
+				comparison.operand.boolean = value.as_bool();
+			} else if (value.is_string()) {
+				comparison.operand.boolean = value.as_string() != "false";
+			} else if (value.is_number()) {
+				comparison.operand.boolean = value.to_number<double>() != 0;
+			}
+		} else {
+			comparison.operand = compile_operand(value);
+		}
+		node.children.push_back(move(comparison));
+	}
+	return node.children.size() == 1 ? node.children[0] : node;
+};
+
+QueryPredicate::Operand QueryPredicate::compile_operand(const boost::json::value& value)
+{
+	Operand operand;
+	switch (value.kind()) {
+	case boost::json::kind::null:
+		operand.kind = Operand::Kind::Null;
+		break;
+	case boost::json::kind::bool_:
+		operand.kind = Operand::Kind::Bool;
+		operand.boolean = value.as_bool();
+		break;
+	case boost::json::kind::int64:
+	case boost::json::kind::uint64:
+	case boost::json::kind::double_:
+		operand.kind = Operand::Kind::Number;
+		operand.number = value.to_number<double>();
+		break;
+	case boost::json::kind::string:
+		operand.kind = Operand::Kind::String;
+		operand.string = string(value.as_string());
+		break;
+	case boost::json::kind::object: {
+		const boost::json::object& object = value.as_object();
+		if (!object.contains("$date")) {
+			throw invalid_argument("Comparing against sub-documents is not supported");
+		}
+		const boost::json::value& date = object.at("$date");
+		operand.kind = Operand::Kind::Date;
+		if (date.is_string()) {
+			operand.date = parse_iso_date(date.as_string().c_str());
+		} else if (date.is_object() && date.as_object().contains("$numberLong")) {
+			operand.date = stoll(string(date.as_object().at("$numberLong").as_string()));
+		} else {
+			operand.date = date.to_number<int64_t>();
+		}
+		break;
+	}
+	default:
+		throw invalid_argument("Unsupported value in query");
+	}
+	return operand;
+};
+
+bsoncxx::document::element QueryPredicate::lookup(const bsoncxx::document::view& doc, const vector<string>& path)
+{
+	bsoncxx::document::view current = doc;
+	for (size_t i = 0; i < path.size(); i++) {
+		auto element = current.find(path[i]);
+		if (element == current.end()) {
+			return bsoncxx::document::element();
+		}
+		if (i == path.size() - 1) {
+			return *element;
+		}
+		if (element->type() != bsoncxx::type::k_document) {
+			return bsoncxx::document::element();
+		}
+		current = element->get_document().view();
+	}
+	return bsoncxx::document::element();
+};
+
+int QueryPredicate::compare(const bsoncxx::document::element& element, const Operand& operand)
+{
+	auto three_way = [](auto a, auto b) { return a < b ? -1 : (a > b ? 1 : 0); };
+	switch (operand.kind) {
+	case Operand::Kind::Null:
+		return element.type() == bsoncxx::type::k_null ? 0 : 2;
+	case Operand::Kind::Bool:
+		return element.type() == bsoncxx::type::k_bool ? three_way(element.get_bool().value, operand.boolean) : 2;
+	case Operand::Kind::Number:
+		switch (element.type()) {
+		case bsoncxx::type::k_int32: return three_way((double)element.get_int32().value, operand.number);
+		case bsoncxx::type::k_int64: return three_way((double)element.get_int64().value, operand.number);
+		case bsoncxx::type::k_double: return three_way(element.get_double().value, operand.number);
+		default: return 2;
+		}
+	case Operand::Kind::String:
+		return element.type() == bsoncxx::type::k_utf8 ? three_way(string_view(element.get_string().value).compare(operand.string), 0) : 2;
+	case Operand::Kind::Date:
+		return element.type() == bsoncxx::type::k_date ? three_way((int64_t)element.get_date().value.count(), operand.date) : 2;
+	}
+	return 2;
+};
+
+bool QueryPredicate::evaluate(const Node& node, const bsoncxx::document::view& doc)
+{
+	switch (node.op) {
+	case Op::And:
+		for (const Node& child : node.children) {
+			if (!evaluate(child, doc)) {
+				return false;
+			}
+		}
+		return true;
+	case Op::Or:
+		for (const Node& child : node.children) {
+			if (evaluate(child, doc)) {
+				return true;
+			}
+		}
+		return false;
+	default:
+		break;
+	}
+
+	bsoncxx::document::element element = lookup(doc, node.path);
+	bool exists = (bool)element;
+	int comparison = exists ? compare(element, node.operand) : 2;
+	switch (node.op) {
+	case Op::Exists:
+		return exists == node.operand.boolean;
+	case Op::Eq:
+		//as in MongoDB, {"field": null} also matches documents without the field
+		if (!exists) {
+			return node.operand.kind == Operand::Kind::Null;
+		}
+		return comparison == 0;
+	case Op::Ne:
+		if (!exists) {
+			return node.operand.kind != Operand::Kind::Null;
+		}
+		return comparison != 0;
+	case Op::Gt:
+		return comparison == 1;
+	case Op::Gte:
+		return comparison == 0 || comparison == 1;
+	case Op::Lt:
+		return comparison == -1;
+	case Op::Lte:
+		return comparison == 0 || comparison == -1;
+	default:
+		return false;
+	}
+};
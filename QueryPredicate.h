@@ -0,0 +1,50 @@
+#pragma once
+#include "utilities.h"
+#include <string>
+#include <string_view>
+#include <boost/json.hpp>
+#include <bsoncxx/document/view.hpp>
+#include <bsoncxx/document/element.hpp>
+
+//a MongoDB find() filter, compiled once and then evaluated directly against BSON documents, so local dumps can be filtered the way the server would
+//supports the subset of the query language the project uses:
+//	{"field": value}, $eq, $ne, $exists, $gt, $gte, $lt, $lte, $and, $or
+//fields can be dotted paths into sub-documents, and dates are written in extended JSON ({"$date": "2020-03-01T00:00:00Z"} or {"$date": <ms>})
+//evaluation doesn't allocate, so one compiled predicate can be shared by any number of scanning threads
+class QueryPredicate
+{
+public:
+	//the value a field is compared against
+	struct Operand {
+		enum class Kind { Null, Bool, Number, String, Date } kind = Kind::Null;
+		bool boolean = false;
+		double number = 0;
+		std::string string;
+		int64_t date = 0;	//milliseconds since the epoch
+	};
+
+	enum class Op { And, Or, Eq, Ne, Exists, Gt, Gte, Lt, Lte };
+
+	struct Node {
+		Op op = Op::And;
+		std::vector<Node> children;	//for And/Or
+		std::vector<std::string> path;	//for comparisons, the field split on '.'
+		Operand operand;
+	};
+private:
+	Node root;
+
+	static Node compile_document(const boost::json::object& filter);
+	static Node compile_field(const std::string& field, const boost::json::value& condition);
+	static Operand compile_operand(const boost::json::value& value);
+	static bool evaluate(const Node& node, const bsoncxx::document::view& doc);
+	static bsoncxx::document::element lookup(const bsoncxx::document::view& doc, const std::vector<std::string>& path);
+	//-1, 0 or 1, or 2 if the element and operand can't be compared (different types)
+	static int compare(const bsoncxx::document::element& element, const Operand& operand);
+public:
+	//throws invalid_argument for operators that aren't supported
+	QueryPredicate(const boost::json::value& filter);
+	static QueryPredicate from_file(const std::string& path);
+
+	bool matches(const bsoncxx::document::view& doc) const { return evaluate(root, doc); }
+};
@@ -0,0 +1,113 @@
+#include "SlidingWindows.h"
+#include "EdgeAccumulator.h"
+#include "GraphBuilder.h"
+
+using namespace std;
+
+SlidingWindows::SlidingWindows(int64_t start, int64_t end, int64_t width, int64_t step, window_handler on_window)
+	: width(width), step(step), end(end), window_start(start), last_time(start), on_window(on_window)
+{
+	if (width <= 0 || step <= 0) {
+		throw invalid_argument("Window width and step must be positive");
+	}
+};
+
+bool SlidingWindows::add(int64_t time, uint64_t user_id, uint64_t connected_user_id)
+{
+	if (time < last_time && time >= window_start) {
+		throw invalid_argument("Interactions must be added in time order");
+	}
+	last_time = max(last_time, time);
+	//windows that end before this interaction are complete
+	while (time >= window_start + width && window_start + width <= end) {
+		emit();
+		advance();
+	}
+	//before the current window (or in a gap between windows when step > width), or after the last one
+	if (time < window_start || time >= window_start + width || user_id == 0 || connected_user_id == 0 || user_id == connected_user_id) {
+		return false;
+	}
+	uint64_t key = EdgeAccumulator::pack(users.intern(user_id), users.intern(connected_user_id));
+	live.push_back({ time, key });
+	edge_weights[key]++;
+	return true;
+};
+
+bool SlidingWindows::add(const bsoncxx::document::view& doc)
+{
+	auto datetime = doc["datetime"];
+	if (!datetime || datetime.type() != bsoncxx::type::k_date) {
+		return false;
+	}
+	return add(datetime.get_date().value.count(), bsonvalue_to_id(doc["user"]), bsonvalue_to_id(doc["connected_user"]));
+};
+
+void SlidingWindows::finish()
+{
+	while (window_start + width <= end) {
+		emit();
+		advance();
+	}
+	live.clear();
+	edge_weights.clear();
+};
+
+void SlidingWindows::advance()
+{
+	window_start += step;
+	while (!live.empty() && live.front().time < window_start) {
+		auto weight = edge_weights.find(live.front().key);
+		if (--weight->second == 0) {
+			edge_weights.erase(weight);
+		}
+		live.pop_front();
+	}
+};
+
+void SlidingWindows::emit()
+{
+	//sorted so a window's graph doesn't depend on the hash map's iteration order
+	vector<pair<uint64_t, uint32_t>> window_edges(edge_weights.begin(), edge_weights.end());
+	sort(window_edges.begin(), window_edges.end());
+
+	//renumber the users active in this window densely, in order of their series-wide vertex IDs
+	vector<uint32_t> series_vertices;
+	series_vertices.reserve(2 * window_edges.size());
+	for (const auto& [key, weight] : window_edges) {
+		series_vertices.push_back(EdgeAccumulator::source(key));
+		series_vertices.push_back(EdgeAccumulator::target(key));
+	}
+	sort(series_vertices.begin(), series_vertices.end());
+	series_vertices.erase(unique(series_vertices.begin(), series_vertices.end()), series_vertices.end());
+	auto local = [&series_vertices](uint32_t v) {
+		return (uint32_t)(lower_bound(series_vertices.begin(), series_vertices.end(), v) - series_vertices.begin());
+	};
+
+	GraphWindow window;
+	window.from = window_start;
+	window.to = window_start + width;
+	window.user_ids.reserve(series_vertices.size());
+	for (uint32_t v : series_vertices) {
+		window.user_ids.push_back(users.user_id(v));
+	}
+	window.graph = new igraph_t();
+
+	//the renumbering keeps the vertex order, so the edges stay sorted by (source, target)
+	igraph_integer_t n = window_edges.size();
+	igraph_vector_int_t edges;
+	igraph_vector_int_init(&edges, 2 * n);
+	igraph_vector_t edge_attribute;
+	igraph_vector_init(&edge_attribute, n);
+	for (igraph_integer_t i = 0; i < n; i++) {
+		VECTOR(edges)[2 * i] = local(EdgeAccumulator::source(window_edges[i].first));
+		VECTOR(edges)[2 * i + 1] = local(EdgeAccumulator::target(window_edges[i].first));
+		VECTOR(edge_attribute)[i] = window_edges[i].second;
+	}
+	igraph_create(window.graph, &edges, series_vertices.size(), IGRAPH_DIRECTED);
+	igraph_cattribute_EAN_setv(window.graph, "weight", &edge_attribute);
+	igraph_vector_int_destroy(&edges);
+	igraph_vector_destroy(&edge_attribute);
+
+	windows_emitted++;
+	on_window(move(window));
+};
@@ -0,0 +1,59 @@
+#pragma once
+#include "utilities.h"
+#include "UserIndex.h"
+#include <cstdint>
+#include <deque>
+#include <unordered_map>
+#include <bsoncxx/document/view.hpp>
+
+//one graph of the series, covering interactions with from <= datetime < to
+struct GraphWindow {
+	int64_t from;	//milliseconds since the epoch
+	int64_t to;
+	igraph_t* graph;	//owned by whoever receives the window. edges have their interaction counts in the "weight" attribute
+	std::vector<uint64_t> user_ids;	//user ID of each vertex of this window's graph
+};
+
+//builds graphs over sliding windows [start + i * step, start + i * step + width) in a single pass over interactions sorted by time
+//the interactions currently inside the window are kept in arrival order, so moving the window on subtracts the ones that
+//left and adds the ones that entered, instead of rebuilding each window from scratch
+//user IDs are interned once for the whole series, and each window's graph only contains the users active in it
+class SlidingWindows
+{
+public:
+	using window_handler = std::function<void(GraphWindow&&)>;
+private:
+	struct Interaction {
+		int64_t time;
+		uint64_t key;	//EdgeAccumulator::pack(source, target), in series-wide vertex IDs
+	};
+
+	int64_t width;
+	int64_t step;
+	int64_t end;
+	int64_t window_start;
+	int64_t last_time;
+	window_handler on_window;
+
+	UserIndex users;
+	std::deque<Interaction> live;	//interactions in the current window, oldest first
+	std::unordered_map<uint64_t, uint32_t> edge_weights;	//interactions per edge in the current window
+	size_t windows_emitted = 0;
+
+	void emit();
+	void advance();
+public:
+	//start and end in milliseconds since the epoch; windows that would extend past end are not emitted
+	//throws invalid_argument unless width and step are positive
+	SlidingWindows(int64_t start, int64_t end, int64_t width, int64_t step, window_handler on_window);
+
+	//interactions must arrive in non-decreasing time order (throws invalid_argument otherwise)
+	//returns false if the interaction isn't used (self interaction, missing users, or outside every window)
+	bool add(int64_t time, uint64_t user_id, uint64_t connected_user_id);
+	//reads datetime, user and connected_user from an interaction document
+	bool add(const bsoncxx::document::view& doc);
+	//emits the remaining windows up to end
+	void finish();
+
+	size_t window_count() const { return windows_emitted; }
+};
@@ -0,0 +1,84 @@
+#include "Spill.h"
+#include "Uploader.h"
+#include "DocumentSource.h"
+#include <fstream>
+#include <filesystem>
+
+using namespace std;
+
+SpillStore::SpillStore(const string& directory) : directory(directory)
+{
+	filesystem::create_directories(directory);
+};
+
+void SpillStore::spill(const UploadBatch& batch)
+{
+	SpillFile file;
+	file.collection = batch.collection;
+	file.documents = batch.documents.size();
+	file.bytes = batch.bytes;
+	file.path = (filesystem::path(directory) / (batch.collection + "-" + to_string(next_id++) + ".bson")).string();
+
+	ofstream out(file.path, ios_base::out | ios_base::binary | ios_base::trunc);
+	for (const auto& doc : batch.documents) {
+		//a BSON document starts with its own length, so the documents can just be written one after another
+		out.write(reinterpret_cast<const char*>(doc.view().data()), doc.view().length());
+	}
+	out.close();
+	if (!out) {
+		throw runtime_error("Could not write spill file " + file.path);
+	}
+
+	spilled_batches++;
+	spilled_bytes += file.bytes;
+	lock_guard<mutex> guard(lock);
+	files.push_back(file);
+};
+
+bool SpillStore::take(SpillFile& out)
+{
+	lock_guard<mutex> guard(lock);
+	if (files.empty()) {
+		return false;
+	}
+	out = files.front();
+	files.pop_front();
+	return true;
+};
+
+ptr<UploadBatch> SpillStore::load(const SpillFile& file)
+{
+	ifstream in(file.path, ios_base::in | ios_base::binary);
+	if (!in) {
+		throw runtime_error("Could not open spill file " + file.path);
+	}
+	vector<uint8_t> buffer(file.bytes);
+	in.read(reinterpret_cast<char*>(buffer.data()), buffer.size());
+	if ((size_t)in.gcount() != buffer.size()) {
+		throw runtime_error("Spill file " + file.path + " is truncated");
+	}
+
+	ptr<UploadBatch> batch = _ptr<UploadBatch>();
+	batch->collection = file.collection;
+	batch->bytes = file.bytes;
+	batch->documents.reserve(file.documents);
+	walk_bson_documents(buffer.data(), buffer.size(), 0, buffer.size(), "Spill file " + file.path, [&batch](size_t, const bsoncxx::document::view& doc) {
+		batch->documents.emplace_back(doc);
+	});
+	return batch;
+};
+
+void SpillStore::remove(const SpillFile& file)
+{
+	error_code error;
+	filesystem::remove(file.path, error);
+	if (error) {
+		cerr << "Could not remove spill file " << file.path << ": " << error.message() << endl;
+	}
+};
+
+size_t SpillStore::pending()
+{
+	lock_guard<mutex> guard(lock);
+	return files.size();
+};
@@ -0,0 +1,43 @@
+#pragma once
+#include "utilities.h"
+#include <atomic>
+#include <mutex>
+#include <deque>
+#include <string>
+
+struct UploadBatch;
+
+//a batch that has been written to disk because the upload stage was over its memory budget
+struct SpillFile {
+	std::string path;
+	std::string collection;
+	size_t documents = 0;
+	size_t bytes = 0;
+};
+
+//local staging area for upload batches that don't fit in memory
+//each batch becomes one file of back to back BSON documents (the same layout as a mongodump .bson file, so it can also be restored by hand)
+class SpillStore
+{
+private:
+	std::string directory;
+	std::mutex lock;
+	std::deque<SpillFile> files;	//oldest first, so batches are replayed roughly in the order they were parsed
+	std::atomic<size_t> next_id = 0;
+	std::atomic<size_t> spilled_batches = 0;
+	std::atomic<size_t> spilled_bytes = 0;
+public:
+	SpillStore(const std::string& directory);
+
+	//writes the batch to disk. the caller can free the batch's documents once this returns
+	void spill(const UploadBatch& batch);
+	//takes the oldest spilled batch, returns false if there are none waiting
+	bool take(SpillFile& out);
+	//reads a spilled batch back into memory
+	ptr<UploadBatch> load(const SpillFile& file);
+	void remove(const SpillFile& file);
+
+	size_t pending();
+	size_t total_batches() const { return spilled_batches; }
+	size_t total_bytes() const { return spilled_bytes; }
+};
@@ -0,0 +1,282 @@
+#include "TermStatistics.h"
+#include "ThreadPool.h"
+#include <cctype>
+#include <cmath>
+#include <future>
+
+using namespace std;
+
+//the code point starting at text[i], setting length to its size in bytes, or to 0 if the bytes there aren't valid utf-8
+static uint32_t decode_utf8(string_view text, size_t i, size_t& length)
+{
+	unsigned char c = text[i];
+	size_t continuation;
+	uint32_t code_point;
+	if (c < 0x80) {
+		length = 1;
+		return c;
+	} else if ((c & 0xE0) == 0xC0) {
+		continuation = 1;
+		code_point = c & 0x1F;
+	} else if ((c & 0xF0) == 0xE0) {
+		continuation = 2;
+		code_point = c & 0x0F;
+	} else if ((c & 0xF8) == 0xF0) {
+		continuation = 3;
+		code_point = c & 0x07;
+	} else {
+		length = 0;
+		return 0;
+	}
+	if (i + continuation >= text.size()) {
+		length = 0;
+		return 0;
+	}
+	for (size_t k = 1; k <= continuation; k++) {
+		unsigned char next = text[i + k];
+		if ((next & 0xC0) != 0x80) {
+			length = 0;
+			return 0;
+		}
+		code_point = (code_point << 6) | (next & 0x3F);
+	}
+	length = continuation + 1;
+	return code_point;
+}
+
+//punctuation, symbols and emoji beyond ascii, which split words the way spaces do
+static bool is_separator(uint32_t code_point)
+{
+	return (code_point >= 0x80 && code_point <= 0xBF)	//latin-1 controls and punctuation: no-break space, guillemets, inverted ? and !
+		|| (code_point >= 0x2000 && code_point <= 0x206F)	//general punctuation: curly quotes, dashes, ellipsis, zero width spaces and joiner
+		|| (code_point >= 0x2190 && code_point <= 0x2BFF)	//arrows, maths, technical and miscellaneous symbols, dingbats
+		|| (code_point >= 0x3000 && code_point <= 0x303F)	//cjk punctuation
+		|| (code_point >= 0xFE00 && code_point <= 0xFE0F)	//variation selectors (text or emoji presentation)
+		|| code_point == 0xFEFF
+		|| (code_point >= 0x1F000 && code_point <= 0x1FAFF)	//emoji, including flags and skin tones
+		|| (code_point >= 0xE0000 && code_point <= 0xE007F);	//tags, as in subdivision flags
+}
+
+//the length in bytes of the apostrophe at text[i], or 0 if there isn't one there
+//phones often turn ' into a right single quote (U+2019), and some keyboards type the modifier letter apostrophe (U+02BC)
+static size_t apostrophe_length(string_view text, size_t i)
+{
+	if (text[i] == '\'') {
+		return 1;
+	}
+	if (text.compare(i, 3, "\xe2\x80\x99") == 0) {
+		return 3;
+	}
+	return text.compare(i, 2, "\xca\xbc") == 0 ? 2 : 0;
+}
+
+//the length in bytes of the word character at text[i], or 0 if there isn't one there
+//apostrophes aren't word characters, though they can be inside a word
+static size_t word_char_length(string_view text, size_t i)
+{
+	unsigned char c = text[i];
+	if (c < 0x80) {
+		return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' ? 1 : 0;
+	}
+	size_t length;
+	uint32_t code_point = decode_utf8(text, i, length);
+	return length == 0 || is_separator(code_point) || code_point == 0x02BC ? 0 : length;
+}
+
+void for_each_term(string_view text, string& scratch, const function<void(string_view)>& visit)
+{
+	size_t i = 0;
+	while (i < text.size()) {
+		unsigned char c = text[i];
+		//links
+		if ((c == 'h' || c == 'H') && (text.compare(i, 7, "http://") == 0 || text.compare(i, 8, "https://") == 0)) {
+			while (i < text.size() && !isspace((unsigned char)text[i])) {
+				i++;
+			}
+			continue;
+		}
+		//html entities, which the API leaves in the text
+		if (c == '&') {
+			size_t end = i + 1;
+			while (end < text.size() && end - i < 8 && isalnum((unsigned char)text[end])) {
+				end++;
+			}
+			i = (end < text.size() && text[end] == ';') ? end + 1 : i + 1;
+			continue;
+		}
+		bool sigil = (c == '#' || c == '@') && i + 1 < text.size() && word_char_length(text, i + 1) > 0;
+		if (!sigil && word_char_length(text, i) == 0) {
+			//the rest of a multi-byte separator isn't valid utf-8 on its own, so it is skipped a byte at a time too
+			i++;
+			continue;
+		}
+
+		scratch.clear();
+		if (sigil) {
+			scratch.push_back(c);
+			i++;
+		}
+		size_t word_start = scratch.size();
+		while (i < text.size()) {
+			unsigned char w = text[i];
+			size_t length = word_char_length(text, i);
+			size_t apostrophe = length == 0 ? apostrophe_length(text, i) : 0;
+			if (length == 1) {
+				scratch.push_back((w >= 'A' && w <= 'Z') ? w - 'A' + 'a' : w);
+				i++;
+			} else if (length > 1) {
+				scratch.append(text.substr(i, length));
+				i += length;
+			} else if (apostrophe > 0 && i + apostrophe < text.size() && word_char_length(text, i + apostrophe) > 0 && scratch.size() > word_start) {
+				//whichever apostrophe was typed it is kept as ', so don't is the same term however it was written
+				scratch.push_back('\'');
+				i += apostrophe;
+			} else {
+				break;
+			}
+		}
+		if (scratch.size() - word_start > 1 || sigil) {
+			visit(scratch);
+		}
+	}
+}
+
+//vertices tokenised by one task
+static const uint32_t users_per_task = 4096;
+
+vector<CommunityTerms> distinctive_terms(const TweetStore& tweets, const vector<size_t>& membership, size_t top_n, size_t min_users, uint64_t min_count)
+{
+	size_t community_count = 0;
+	for (size_t community : membership) {
+		community_count = max(community_count, community + 1);
+	}
+	vector<size_t> community_users(community_count);
+	for (size_t community : membership) {
+		community_users[community]++;
+	}
+	//the communities that get scored have their own counts, the rest share one bucket that only goes into the background
+	vector<size_t> bucket_of(community_count);
+	vector<CommunityTerms> results;
+	for (size_t community = 0; community < community_count; community++) {
+		if (community_users[community] >= min_users) {
+			bucket_of[community] = results.size();
+			CommunityTerms result;
+			result.community = community;
+			result.users = community_users[community];
+			results.push_back(move(result));
+		}
+	}
+	size_t other_bucket = results.size();
+	for (size_t community = 0; community < community_count; community++) {
+		if (community_users[community] < min_users) {
+			bucket_of[community] = other_bucket;
+		}
+	}
+	size_t buckets = results.size() + 1;
+
+	//tokenise, each task counting into maps of its own
+	ThreadPool* thread_pool = ThreadPool::getInstance();
+	uint32_t users = (uint32_t)min(membership.size(), tweets.user_count());
+	vector<future<vector<term_counts>>> scans;
+	for (uint32_t begin = 0; begin < users; begin += users_per_task) {
+		uint32_t end = min(users, begin + users_per_task);
+		scans.push_back(thread_pool->submit([&tweets, &membership, &bucket_of, buckets, begin, end]() {
+			vector<term_counts> counts(buckets);
+			string scratch;
+			tweets.for_each_tweet_in(begin, end, [&](uint32_t vertex, string_view text) {
+				term_counts& bucket = counts[bucket_of[membership[vertex]]];
+				for_each_term(text, scratch, [&bucket](string_view term) {
+					auto found = bucket.find(term);
+					if (found != bucket.end()) {
+						found->second++;
+					} else {
+						bucket.emplace(string(term), 1);
+					}
+				});
+			});
+			return counts;
+		}));
+	}
+	vector<vector<term_counts>> scanned;
+	for (auto& scan : scans) {
+		scanned.push_back(scan.get());
+	}
+
+	//merge each bucket on its own task
+	vector<future<term_counts>> merges;
+	for (size_t b = 0; b < buckets; b++) {
+		merges.push_back(thread_pool->submit([&scanned, b]() {
+			term_counts merged;
+			for (vector<term_counts>& counts : scanned) {
+				if (merged.empty()) {
+					merged = move(counts[b]);
+					continue;
+				}
+				for (auto& [term, count] : counts[b]) {
+					merged[term] += count;
+				}
+				term_counts().swap(counts[b]);
+			}
+			return merged;
+		}));
+	}
+	vector<term_counts> bucket_counts;
+	for (auto& merge : merges) {
+		bucket_counts.push_back(merge.get());
+	}
+	scanned.clear();
+
+	term_counts background;
+	uint64_t background_total = 0;
+	for (const term_counts& counts : bucket_counts) {
+		for (const auto& [term, count] : counts) {
+			background[term] += count;
+			background_total += count;
+		}
+	}
+	if (background_total == 0) {
+		return results;
+	}
+
+	//the prior is the background distribution, as strong as the average community is big
+	double prior_total = (double)background_total / buckets;
+
+	vector<future<void>> scorings;
+	for (size_t r = 0; r < results.size(); r++) {
+		scorings.push_back(thread_pool->submit([&, r]() {
+			const term_counts& counts = bucket_counts[r];
+			CommunityTerms& result = results[r];
+			for (const auto& [term, count] : counts) {
+				result.terms += count;
+			}
+			double rest_total = (double)(background_total - result.terms);
+			vector<TermScore> scores;
+			for (const auto& [term, count] : counts) {
+				if (count < min_count) {
+					continue;
+				}
+				uint64_t total = background.find(term)->second;
+				double alpha = prior_total * total / background_total;
+				double inside = count + alpha;
+				double outside = (total - count) + alpha;
+				double delta = log(inside / (result.terms + prior_total - inside)) - log(outside / (rest_total + prior_total - outside));
+				double variance = 1 / inside + 1 / outside;
+				scores.push_back({ term, count, delta / sqrt(variance) });
+			}
+			size_t keep = min(top_n, scores.size());
+			partial_sort(scores.begin(), scores.begin() + keep, scores.end(), [](const TermScore& a, const TermScore& b) {
+				return a.z > b.z;
+			});
+			scores.resize(keep);
+			result.top = move(scores);
+		}));
+	}
+	for (auto& scoring : scorings) {
+		scoring.get();
+	}
+
+	stable_sort(results.begin(), results.end(), [](const CommunityTerms& a, const CommunityTerms& b) {
+		return a.users > b.users;
+	});
+	return results;
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include "utilities.h"
+#include "TweetStore.h"
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+//splits a tweet into terms, calling visit with each. the views are only valid during the call
+//terms are runs of letters, digits and _ (ascii lowercased, other utf-8 characters kept as they are), with an apostrophe allowed
+//inside a word (', U+2019 or U+02BC, all kept as '). non-ascii punctuation, symbols and emoji separate words, as does anything that isn't valid utf-8. #hashtags and @mentions keep their sigil, links and html entities (&amp;) are dropped, as are single characters
+//scratch holds the lowercased term, so one can be reused across calls to save allocating
+void for_each_term(std::string_view text, std::string& scratch, const std::function<void(std::string_view)>& visit);
+
+//lets term counts be looked up by string_view without making a string first
+struct TermHash {
+	using is_transparent = void;
+	size_t operator()(std::string_view term) const { return std::hash<std::string_view>{}(term); }
+};
+using term_counts = std::unordered_map<std::string, uint64_t, TermHash, std::equal_to<>>;
+
+struct TermScore {
+	std::string term;
+	uint64_t count = 0;	//in the community
+	double z = 0;	//log-odds of the term in the community against everyone else, in standard deviations
+};
+
+//the terms that most set a community apart from the rest
+struct CommunityTerms {
+	size_t community = 0;
+	size_t users = 0;
+	uint64_t terms = 0;	//term occurrences in the community's tweets
+	std::vector<TermScore> top;	//highest z first
+};
+
+//counts the terms of every user's tweets by their community (tokenised concurrently on the ThreadPool, each task counting into
+//its own maps, which are merged at the end), then scores each term of each community with at least min_users members by its
+//log-odds ratio with an informative dirichlet prior (Monroe, Colaresi and Quinn, 2008) against all the other communities together
+//terms a community used fewer than min_count times aren't scored for it. results are largest community first
+std::vector<CommunityTerms> distinctive_terms(const TweetStore& tweets, const std::vector<size_t>& membership,
+	size_t top_n = 20, size_t min_users = 50, uint64_t min_count = 5);
@@ -13,17 +13,20 @@ ThreadPool::ThreadPool() {
 	for (unsigned int i = 0; i < numCores; ++i) {
 		workers.emplace_back(
 			[this] {
-				function<void()> task;
-				{
-					unique_lock<mutex> lock(this->queue_mutex);
-					this->condition.wait(lock, [this] { return this->stop || !this->tasks.empty(); });
-					if (this->stop && this->tasks.empty()) {
-						return;
+				//keep taking tasks until the pool is shut down
+				while (true) {
+					function<void()> task;
+					{
+						unique_lock<mutex> lock(this->queue_mutex);
+						this->condition.wait(lock, [this] { return this->stop || !this->tasks.empty(); });
+						if (this->stop && this->tasks.empty()) {
+							return;
+						}
+						task = move(this->tasks.front());
+						this->tasks.pop();
 					}
-					task = move(this->tasks.front());
-					this->tasks.pop();
+					task();
 				}
-				task();
 			}
 		);
 	}
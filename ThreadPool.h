@@ -29,6 +29,8 @@ public:
 	template<class F, class... Args>
 	auto submit(F&& f, Args&&... args) -> std::future<typename std::invoke_result_t<F, Args...>>;
 
+	size_t size() const { return workers.size(); }
+
 private:
 	// Vector of worker threads
 	std::vector<std::thread> workers;
@@ -52,7 +54,7 @@ auto ThreadPool::distribute(F&& f, std::vector<T>* v, Args&&... args) -> std::ve
 	for (int i = 0; i < divisions; i++) {
 		int start = i * chunk_size;
 		int end = (i == divisions - 1) ? v->size() : (i + 1) * chunk_size;
-		futures.emplace_back(submit(forward<F>(f), v, start, end, forward<Args>(args)));
+		futures.emplace_back(submit(forward<F>(f), v, start, end, forward<Args>(args)...));
 	}
 
 	// Collect the results from all futures
@@ -0,0 +1,274 @@
+#include "TweetStore.h"
+#include <cstdlib>
+#include <boost/iostreams/filtering_stream.hpp>
+#include <boost/iostreams/filter/zlib.hpp>
+#include <boost/iostreams/device/back_inserter.hpp>
+
+using namespace std;
+
+//uncompressed text per compressed block. small enough that reading one user's tweets doesn't inflate much else,
+//big enough for zlib to find the repetition between tweets
+static const size_t compressed_block_size = 64 * 1024;
+
+static string zlib_filter(const char* data, size_t size, bool compress)
+{
+	string out;
+	boost::iostreams::filtering_ostream stream;
+	if (compress) {
+		stream.push(boost::iostreams::zlib_compressor());
+	} else {
+		stream.push(boost::iostreams::zlib_decompressor());
+	}
+	stream.push(boost::iostreams::back_inserter(out));
+	stream.write(data, size);
+	stream.reset();	//flushes the filter into out
+	return out;
+};
+
+TweetStore::TweetStore(Mode mode) : mode(mode)
+{
+};
+
+void TweetStore::check_sealed() const
+{
+	if (!sealed) {
+		throw logic_error("The tweet store must be sealed before it is read");
+	}
+};
+
+void TweetStore::append(TweetStore& other, const vector<uint32_t>& mapping)
+{
+	if (sealed || other.sealed) {
+		throw logic_error("Can't append to or from a sealed tweet store");
+	}
+	uint64_t base = arena.size();
+	arena.append(other.arena);
+	tweet_ends.reserve(tweet_ends.size() + other.tweet_ends.size());
+	tweet_vertices.reserve(tweet_vertices.size() + other.tweet_vertices.size());
+	for (size_t i = 0; i < other.tweet_ends.size(); i++) {
+		tweet_ends.push_back(base + other.tweet_ends[i]);
+		tweet_vertices.push_back(mapping[other.tweet_vertices[i]]);
+	}
+	other.arena = string();
+	other.tweet_ends = vector<uint64_t>();
+	other.tweet_vertices = vector<uint32_t>();
+};
+
+void TweetStore::seal(size_t vertex_count)
+{
+	if (sealed) {
+		return;
+	}
+	for (uint32_t v : tweet_vertices) {
+		vertex_count = max<size_t>(vertex_count, (size_t)v + 1);
+	}
+
+	//counting sort by vertex, which keeps each user's tweets in the order they came in
+	user_first_tweet.assign(vertex_count + 1, 0);
+	for (uint32_t v : tweet_vertices) {
+		user_first_tweet[v + 1]++;
+	}
+	for (size_t v = 0; v < vertex_count; v++) {
+		user_first_tweet[v + 1] += user_first_tweet[v];
+	}
+	vector<uint64_t> position(user_first_tweet.begin(), user_first_tweet.end() - 1);
+	vector<uint64_t> order(tweet_ends.size());
+	for (uint64_t t = 0; t < tweet_vertices.size(); t++) {
+		order[position[tweet_vertices[t]]++] = t;
+	}
+	tweet_vertices = vector<uint32_t>();
+	position = vector<uint64_t>();
+
+	string grouped;
+	grouped.reserve(arena.size());
+	vector<uint64_t> grouped_ends(tweet_ends.size());
+	for (uint64_t i = 0; i < order.size(); i++) {
+		uint64_t t = order[i];
+		grouped.append(arena, tweet_start(t), tweet_ends[t] - tweet_start(t));
+		grouped_ends[i] = grouped.size();
+	}
+	arena = move(grouped);
+	tweet_ends = move(grouped_ends);
+	sealed = true;
+
+	if (mode == Mode::Compressed) {
+		compress();
+	}
+};
+
+void TweetStore::compress()
+{
+	string compressed;
+	uint64_t first_tweet = 0;
+	while (first_tweet < tweet_ends.size()) {
+		uint64_t start = tweet_start(first_tweet);
+		uint64_t last_tweet = first_tweet + 1;
+		while (last_tweet < tweet_ends.size() && tweet_ends[last_tweet] - start <= compressed_block_size) {
+			last_tweet++;
+		}
+		compressed += zlib_filter(arena.data() + start, tweet_ends[last_tweet - 1] - start, true);
+		block_first_tweet.push_back(first_tweet);
+		block_ends.push_back(compressed.size());
+		first_tweet = last_tweet;
+	}
+	compressed.shrink_to_fit();
+	arena = move(compressed);
+};
+
+string TweetStore::decompress_block(size_t block) const
+{
+	uint64_t start = block == 0 ? 0 : block_ends[block - 1];
+	return zlib_filter(arena.data() + start, block_ends[block] - start, false);
+};
+
+void TweetStore::keep_users(const vector<uint32_t>& new_to_old)
+{
+	check_sealed();
+	bool compressed = mode == Mode::Compressed;
+	string kept;	//plain, the kept text. compressed, the blocks finished so far
+	string block;	//compressed, the text of the block being filled
+	uint64_t kept_bytes = 0;	//of uncompressed text
+	vector<uint64_t> kept_ends;
+	vector<uint64_t> kept_first_tweet(new_to_old.size() + 1, 0);
+	vector<uint64_t> kept_block_first_tweet;
+	vector<uint64_t> kept_block_ends;
+	//blocks are cut where compress() would cut them, at the last tweet that fits
+	auto finish_block = [&]() {
+		kept += zlib_filter(block.data(), block.size(), true);
+		kept_block_ends.push_back(kept.size());
+		block.clear();
+	};
+	auto keep = [&](string_view text) {
+		if (compressed) {
+			bool open = kept_block_first_tweet.size() > kept_block_ends.size();
+			if (open && block.size() + text.size() > compressed_block_size) {
+				finish_block();
+				open = false;
+			}
+			if (!open) {
+				kept_block_first_tweet.push_back(kept_ends.size());
+			}
+			block.append(text);
+		} else {
+			kept.append(text);
+		}
+		kept_bytes += text.size();
+		kept_ends.push_back(kept_bytes);
+	};
+
+	//consecutive old vertices are scanned together, and the block cache carries over from one run to the next
+	BlockCache cache;
+	size_t v = 0;
+	while (v < new_to_old.size()) {
+		size_t run_end = v + 1;
+		while (run_end < new_to_old.size() && new_to_old[run_end] == new_to_old[run_end - 1] + 1) {
+			run_end++;
+		}
+		uint32_t first_old = new_to_old[v];
+		scan_tweets(first_old, new_to_old[run_end - 1] + 1, cache, [&](uint32_t old_vertex, string_view text) {
+			keep(text);
+			kept_first_tweet[v + (old_vertex - first_old) + 1]++;
+		});
+		v = run_end;
+	}
+	for (size_t u = 0; u < new_to_old.size(); u++) {
+		kept_first_tweet[u + 1] += kept_first_tweet[u];
+	}
+	if (compressed && kept_block_first_tweet.size() > kept_block_ends.size()) {
+		finish_block();
+	}
+	kept.shrink_to_fit();
+	arena = move(kept);
+	tweet_ends = move(kept_ends);
+	user_first_tweet = move(kept_first_tweet);
+	block_first_tweet = move(kept_block_first_tweet);
+	block_ends = move(kept_block_ends);
+};
+
+size_t TweetStore::user_count() const
+{
+	check_sealed();
+	return user_first_tweet.size() - 1;
+};
+
+size_t TweetStore::tweet_count(uint32_t vertex) const
+{
+	check_sealed();
+	if ((size_t)vertex + 1 >= user_first_tweet.size()) {
+		return 0;
+	}
+	return user_first_tweet[vertex + 1] - user_first_tweet[vertex];
+};
+
+void TweetStore::for_each_tweet(uint32_t vertex, const function<void(string_view)>& visit) const
+{
+	for_each_tweet_in(vertex, vertex + 1, [&visit](uint32_t, string_view text) {
+		visit(text);
+	});
+};
+
+void TweetStore::for_each_tweet_in(uint32_t begin, uint32_t end, const function<void(uint32_t, string_view)>& visit) const
+{
+	BlockCache cache;
+	scan_tweets(begin, end, cache, visit);
+};
+
+void TweetStore::scan_tweets(uint32_t begin, uint32_t end, BlockCache& cache, const function<void(uint32_t, string_view)>& visit) const
+{
+	check_sealed();
+	end = (uint32_t)min<size_t>(end, user_count());
+	if (begin >= end) {
+		return;
+	}
+	//the range's tweets are contiguous, so each block is decompressed at most once
+	uint32_t vertex = begin;
+	for (uint64_t t = user_first_tweet[begin]; t < user_first_tweet[end]; t++) {
+		while (t >= user_first_tweet[vertex + 1]) {
+			vertex++;
+		}
+		if (mode != Mode::Compressed) {
+			visit(vertex, string_view(arena.data() + tweet_start(t), tweet_ends[t] - tweet_start(t)));
+			continue;
+		}
+		if (cache.block == SIZE_MAX || t < block_first_tweet[cache.block]
+			|| (cache.block + 1 < block_first_tweet.size() && t >= block_first_tweet[cache.block + 1])) {
+			size_t block = upper_bound(block_first_tweet.begin(), block_first_tweet.end(), t) - block_first_tweet.begin() - 1;
+			cache.text = decompress_block(block);
+			cache.start = tweet_start(block_first_tweet[block]);
+			cache.block = block;
+		}
+		visit(vertex, string_view(cache.text.data() + (tweet_start(t) - cache.start), tweet_ends[t] - tweet_start(t)));
+	}
+};
+
+vector<string> TweetStore::tweets(uint32_t vertex) const
+{
+	vector<string> out;
+	out.reserve(tweet_count(vertex));
+	for_each_tweet(vertex, [&out](string_view text) {
+		out.emplace_back(text);
+	});
+	return out;
+};
+
+size_t TweetStore::memory_usage() const
+{
+	return arena.capacity()
+		+ (tweet_ends.capacity() + user_first_tweet.capacity() + block_first_tweet.capacity() + block_ends.capacity()) * sizeof(uint64_t)
+		+ tweet_vertices.capacity() * sizeof(uint32_t);
+};
+
+TweetStore::Mode tweet_text_mode_from_env()
+{
+	const char* mode = getenv("POLPOL_TWEET_TEXT");
+	if (mode == NULL || string(mode) == "plain") {
+		return TweetStore::Mode::Plain;
+	}
+	if (string(mode) == "none") {
+		return TweetStore::Mode::None;
+	}
+	if (string(mode) == "compressed") {
+		return TweetStore::Mode::Compressed;
+	}
+	throw invalid_argument("POLPOL_TWEET_TEXT must be none, plain or compressed, not " + string(mode));
+};
@@ -0,0 +1,83 @@
+#pragma once
+#include "utilities.h"
+#include <string>
+#include <string_view>
+#include <cstdint>
+
+//the tweet text of every user, indexed by vertex ID
+//tweets are appended to one string arena as they arrive, then seal() groups them by user, so each user's tweets are one contiguous
+//range of the arena rather than a heap string per tweet and a vector per user
+//the arena can be zlib compressed in blocks as it is sealed, or text can be skipped entirely when nothing will read it
+//not thread safe while adding. once sealed it is read only, and any number of threads can read it
+class TweetStore
+{
+public:
+	enum class Mode { None, Plain, Compressed };
+private:
+	Mode mode;
+	bool sealed = false;
+
+	std::string arena;	//text of every tweet, back to back
+	std::vector<uint64_t> tweet_ends;	//end of each tweet in the arena, so tweet i is [tweet_ends[i - 1], tweet_ends[i])
+	std::vector<uint32_t> tweet_vertices;	//whose each tweet is, until sealed
+	std::vector<uint64_t> user_first_tweet;	//once sealed, the tweets of vertex v are [user_first_tweet[v], user_first_tweet[v + 1])
+
+	//compressed: the arena is cut into blocks at tweet boundaries, each compressed on its own
+	std::vector<uint64_t> block_first_tweet;
+	std::vector<uint64_t> block_ends;	//end of each compressed block in the arena
+
+	//the last block decompressed by a scan, so scans that carry on where another left off don't decompress it again
+	struct BlockCache {
+		size_t block = SIZE_MAX;
+		std::string text;
+		uint64_t start = 0;	//of the block's text in the uncompressed arena
+	};
+
+	uint64_t tweet_start(uint64_t tweet) const { return tweet == 0 ? 0 : tweet_ends[tweet - 1]; }
+	void compress();
+	std::string decompress_block(size_t block) const;
+	void scan_tweets(uint32_t begin, uint32_t end, BlockCache& cache, const std::function<void(uint32_t, std::string_view)>& visit) const;
+	void check_sealed() const;
+public:
+	TweetStore(Mode mode = Mode::Plain);
+
+	Mode text_mode() const { return mode; }
+	bool keeps_text() const { return mode != Mode::None; }
+	bool is_sealed() const { return sealed; }
+
+	void add(uint32_t vertex, std::string_view text) {
+		if (mode == Mode::None) {
+			return;
+		}
+		arena.append(text);
+		tweet_ends.push_back(arena.size());
+		tweet_vertices.push_back(vertex);
+	}
+	//adds another (unsealed) store's tweets after this one's, renumbering its vertex v as mapping[v]. other is left empty
+	void append(TweetStore& other, const std::vector<uint32_t>& mapping);
+	//groups the tweets by user, keeping each user's tweets in the order they were added, and compresses them if asked to
+	//vertex_count covers users without tweets. no more tweets can be added afterwards
+	void seal(size_t vertex_count);
+
+	//keeps only the tweets of the given users, so that new vertex v has the tweets old vertex new_to_old[v] had
+	//for after the graph has been pruned. the store must be sealed
+	//compressed, each old block is decompressed once as long as new_to_old is increasing, and the kept text is compressed as it goes
+	void keep_users(const std::vector<uint32_t>& new_to_old);
+
+	//these throw logic_error before the store is sealed
+	size_t user_count() const;
+	size_t tweet_count(uint32_t vertex) const;
+	size_t tweet_count() const { return tweet_ends.size(); }
+	//calls visit with each of the user's tweets, in order. the views are only valid during the call
+	void for_each_tweet(uint32_t vertex, const std::function<void(std::string_view)>& visit) const;
+	//the same for every user in [begin, end), in vertex order, for scanning many users without decompressing a block more than once
+	void for_each_tweet_in(uint32_t begin, uint32_t end, const std::function<void(uint32_t, std::string_view)>& visit) const;
+	std::vector<std::string> tweets(uint32_t vertex) const;
+
+	//bytes of text held, after any compression
+	size_t text_bytes() const { return arena.size(); }
+	size_t memory_usage() const;
+};
+
+//reads POLPOL_TWEET_TEXT (none, plain or compressed), defaulting to plain
+TweetStore::Mode tweet_text_mode_from_env();
@@ -0,0 +1,245 @@
+#include "Uploader.h"
+#include <mongocxx/client.hpp>
+#include <mongocxx/uri.hpp>
+#include <mongocxx/exception/bulk_write_exception.hpp>
+#include <mongocxx/exception/operation_exception.hpp>
+#include <bsoncxx/json.hpp>
+
+using namespace std;
+
+BulkUploader::BulkUploader(const string& uri, const string& database_name, size_t writer_count, size_t queue_depth, size_t batch_bytes, int max_retries,
+	size_t memory_budget, const string& spill_directory)
+	: database_name(database_name), batch_bytes(batch_bytes), max_retries(max_retries), memory_budget(memory_budget),
+	pool(mongocxx::uri{ uri }), queue(max<size_t>(queue_depth, memory_budget / max<size_t>(batch_bytes, 1))), spill_store(spill_directory)
+{
+	//the writers get their own threads rather than running on the ThreadPool
+	//they spend most of their time blocked on the network, and the parsers feeding them are already using the pool's workers
+	//(if the writers were queued behind parsers that are waiting on a full upload queue, nothing would ever move)
+	for (size_t i = 0; i < writer_count; i++) {
+		writers.emplace_back(&BulkUploader::writer_loop, this);
+	}
+};
+
+BulkUploader::~BulkUploader()
+{
+	finish();
+};
+
+void BulkUploader::push(const string& collection, bsoncxx::document::value&& doc)
+{
+	ptr<UploadBatch> full_batch;
+	{
+		lock_guard<mutex> guard(staging_lock);
+		ptr<UploadBatch>& batch = staging[collection];
+		if (!batch) {
+			batch = _ptr<UploadBatch>();
+			batch->collection = collection;
+		}
+		size_t doc_bytes = doc.view().length();
+		batch->bytes += doc_bytes;
+		batch->documents.push_back(move(doc));
+		size_t resident = resident_bytes += doc_bytes;
+		size_t peak = peak_resident_bytes;
+		while (resident > peak && !peak_resident_bytes.compare_exchange_weak(peak, resident));
+		if (batch->bytes >= batch_bytes) {
+			full_batch = batch;
+			batch = nullptr;
+		}
+	}
+	//enqueue outside the lock, it may write the batch to disk
+	if (full_batch) {
+		enqueue(full_batch);
+	}
+};
+
+document_sink BulkUploader::sink_for(const string& collection)
+{
+	return [this, collection](bsoncxx::document::value&& doc) {
+		push(collection, move(doc));
+	};
+};
+
+void BulkUploader::release(size_t bytes)
+{
+	resident_bytes -= bytes;
+};
+
+void BulkUploader::batch_done(size_t bytes)
+{
+	release(bytes);
+	if (--outstanding_batches == 0) {
+		lock_guard<mutex> guard(idle_lock);
+		idle.notify_all();
+	}
+};
+
+void BulkUploader::enqueue(ptr<UploadBatch> batch)
+{
+	outstanding_batches++;
+	//over budget: park the batch on disk rather than holding it until a writer is free
+	//(the staging batches that are still filling count towards the budget too, so this also covers a slow start)
+	if (resident_bytes > memory_budget) {
+		spill_store.spill(*batch);
+		release(batch->bytes);	//not batch_done, the batch is still outstanding until it's replayed
+		return;
+	}
+	if (!queue.push(batch)) {
+		cerr << "Upload queue closed, dropping batch of " << batch->documents.size() << " documents" << endl;
+		failed_count += batch->documents.size();
+		batch_done(batch->bytes);
+	}
+};
+
+void BulkUploader::enqueue_staged()
+{
+	vector<ptr<UploadBatch>> remaining;
+	{
+		lock_guard<mutex> guard(staging_lock);
+		for (auto& [collection, batch] : staging) {
+			if (batch && !batch->documents.empty()) {
+				remaining.push_back(batch);
+			}
+		}
+		staging.clear();
+	}
+	for (ptr<UploadBatch> batch : remaining) {
+		enqueue(batch);
+	}
+};
+
+void BulkUploader::flush()
+{
+	enqueue_staged();
+	unique_lock<mutex> guard(idle_lock);
+	idle.wait(guard, [this] { return outstanding_batches == 0; });
+};
+
+void BulkUploader::finish()
+{
+	if (finished) {
+		return;
+	}
+	finished = true;
+
+	enqueue_staged();
+	queue.close();
+	for (thread& writer : writers) {
+		writer.join();
+	}
+	writers.clear();
+};
+
+void BulkUploader::writer_loop()
+{
+	ptr<UploadBatch> batch;
+	SpillFile spilled;
+	while (true) {
+		if (queue.pop_for(batch, chrono::milliseconds(100))) {
+			write_batch(*batch);
+			batch_count++;
+			batch_done(batch->bytes);
+			batch = nullptr;
+			continue;
+		}
+		//the in-memory queue is empty, so there is room to bring spilled batches back in
+		//(with nothing held at all, one comes back regardless, or a budget smaller than a batch would never let any back)
+		if (resident_bytes == 0 || resident_bytes + batch_bytes <= memory_budget || queue.is_closed()) {
+			if (spill_store.take(spilled)) {
+				try {
+					batch = spill_store.load(spilled);
+				} catch (const exception& e) {
+					cerr << e.what() << endl;
+					failed_count += spilled.documents;
+					batch_done(0);
+					continue;
+				}
+				resident_bytes += batch->bytes;
+				write_batch(*batch);
+				batch_count++;
+				spill_store.remove(spilled);
+				batch_done(batch->bytes);
+				batch = nullptr;
+				continue;
+			}
+		}
+		if (queue.is_closed() && queue.size() == 0 && spill_store.pending() == 0) {
+			return;
+		}
+	}
+};
+
+void BulkUploader::write_batch(UploadBatch& batch)
+{
+	vector<bsoncxx::document::view> views;
+	views.reserve(batch.documents.size());
+	for (const auto& doc : batch.documents) {
+		views.push_back(doc.view());
+	}
+
+	mongocxx::options::insert insert_options;
+	insert_options.ordered(false);	//unordered so one duplicate doesn't stop the rest of the batch
+
+	for (int attempt = 0; ; attempt++) {
+		try {
+			auto client = pool.acquire();
+			auto collection = (*client)[database_name][batch.collection];
+			auto result = collection.insert_many(views, insert_options);
+			if (result) {
+				inserted_count += result->inserted_count();
+			}
+			return;
+		} catch (const mongocxx::bulk_write_exception& e) {
+			//the server processed the batch but some documents were rejected
+			//with an unordered insert everything else has gone in, so this isn't worth retrying
+			if (!e.raw_server_error()) {
+				//no server response means we never got as far as the server, treat it like any other transient error
+				if (attempt < max_retries) {
+					retry_count++;
+					this_thread::sleep_for(chrono::milliseconds(250 << attempt));
+					continue;
+				}
+				cerr << "Batch failed after " << attempt + 1 << " attempts: " << e.what() << endl;
+				failed_count += batch.documents.size();
+				return;
+			}
+			auto error_bson = (*(e.raw_server_error())).view();
+			if (error_bson["nInserted"]) {
+				inserted_count += error_bson["nInserted"].get_int32();
+			}
+			if (error_bson["writeErrors"]) {
+				for (const auto element : error_bson["writeErrors"].get_array().value) {
+					if (element.get_document().view()["code"].get_int32() == 11000) {
+						duplicate_count++;
+					} else {
+						failed_count++;
+						cerr << "Write error: " << bsoncxx::to_json(element.get_document().view()) << endl;
+					}
+				}
+			}
+			return;
+		} catch (const mongocxx::exception& e) {
+			//network errors, elections, timeouts etc.
+			//retrying may turn some already inserted documents into duplicate key errors, which are harmless
+			if (attempt < max_retries) {
+				retry_count++;
+				cerr << "Batch insert failed (" << e.what() << "), retrying..." << endl;
+				this_thread::sleep_for(chrono::milliseconds(250 << attempt));
+				continue;
+			}
+			cerr << "Batch failed after " << attempt + 1 << " attempts: " << e.what() << endl;
+			failed_count += batch.documents.size();
+			return;
+		}
+	}
+};
+
+void BulkUploader::print_stats() const
+{
+	cout << "Batches uploaded: " << batch_count << endl;
+	cout << "Inserted: " << inserted_count << " documents" << endl;
+	cout << "Duplicates skipped: " << duplicate_count << endl;
+	cout << "Failed: " << failed_count << endl;
+	cout << "Retries: " << retry_count << endl;
+	cout << "Batches spilled to disk: " << spill_store.total_batches() << " (" << spill_store.total_bytes() / 1024 / 1024 << "MB)" << endl;
+	cout << "Peak staged documents: " << peak_resident_bytes / 1024 / 1024 << "MB" << endl;
+};
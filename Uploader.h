@@ -0,0 +1,90 @@
+#pragma once
+#include "utilities.h"
+#include "BoundedQueue.h"
+#include "Spill.h"
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <map>
+#include <string>
+#include <mongocxx/pool.hpp>
+#include <bsoncxx/document/value.hpp>
+
+//where the parser sends each converted document
+using document_sink = std::function<void(bsoncxx::document::value&&)>;
+
+//a group of documents bound for the same collection, inserted with a single insert_many
+struct UploadBatch {
+	std::string collection;
+	std::vector<bsoncxx::document::value> documents;
+	size_t bytes = 0;
+};
+
+//upload stage of the ingestion pipeline
+//parsers push documents in from any thread; full batches go onto a bounded queue that several writers drain concurrently,
+//each with its own connection from a mongocxx::pool, so parsing and network I/O overlap
+//documents held by the uploader are kept under memory_budget bytes; past that, full batches are spilled to disk and
+//the writers replay them whenever the in-memory queue runs dry
+//the queue holds as many batches as fit in the budget (and at least queue_depth), so while the writers are behind the
+//parsers keep going until the budget is used up, and then spill rather than wait (POLPOL_MEMORY_BUDGET_MB when ingesting)
+class BulkUploader
+{
+private:
+	std::string database_name;
+	size_t batch_bytes;
+	int max_retries;
+	size_t memory_budget;
+
+	mongocxx::pool pool;
+	BoundedQueue<ptr<UploadBatch>> queue;
+	SpillStore spill_store;
+	std::vector<std::thread> writers;
+
+	//batches currently being filled, one per collection
+	std::mutex staging_lock;
+	std::map<std::string, ptr<UploadBatch>> staging;
+
+	std::atomic<size_t> inserted_count = 0;
+	std::atomic<size_t> duplicate_count = 0;	//duplicate key (11000) errors, ie. documents that were already in the database
+	std::atomic<size_t> failed_count = 0;		//documents that could not be inserted for any other reason
+	std::atomic<size_t> batch_count = 0;
+	std::atomic<size_t> retry_count = 0;
+	std::atomic<size_t> resident_bytes = 0;	//bytes of documents currently held in memory, staged, queued or being written
+	std::atomic<size_t> peak_resident_bytes = 0;
+	//batches handed to the writers (queued, spilled or being written) that haven't finished yet
+	std::atomic<size_t> outstanding_batches = 0;
+	std::mutex idle_lock;
+	std::condition_variable idle;
+	bool finished = false;
+
+	void writer_loop();
+	void write_batch(UploadBatch& batch);
+	void enqueue(ptr<UploadBatch> batch);
+	void release(size_t bytes);
+	void batch_done(size_t bytes);
+	void enqueue_staged();
+public:
+	BulkUploader(const std::string& uri, const std::string& database_name, size_t writer_count = 4, size_t queue_depth = 8, size_t batch_bytes = 16 * 1024 * 1024, int max_retries = 5,
+		size_t memory_budget = 2ULL * 1024 * 1024 * 1024, const std::string& spill_directory = "spill");
+	BulkUploader(const BulkUploader&) = delete;
+	BulkUploader& operator=(const BulkUploader&) = delete;
+	~BulkUploader();
+
+	//thread safe. once the writers have fallen behind by the whole budget, full batches are spilled to disk
+	void push(const std::string& collection, bsoncxx::document::value&& doc);
+	document_sink sink_for(const std::string& collection);
+	//uploads any partially filled batches and blocks until everything pushed so far has been written
+	//only meaningful while nothing else is pushing
+	void flush();
+	//uploads any partially filled batches and waits for the writers to finish
+	void finish();
+
+	size_t inserted() const { return inserted_count; }
+	size_t duplicates() const { return duplicate_count; }
+	size_t failed() const { return failed_count; }
+	size_t batches() const { return batch_count; }
+	size_t retries() const { return retry_count; }
+	size_t peak_resident() const { return peak_resident_bytes; }
+	size_t spilled() const { return spill_store.total_batches(); }
+	void print_stats() const;
+};
@@ -0,0 +1,72 @@
+#include "UserIndex.h"
+#include "IdSet.h"
+
+using namespace std;
+
+UserIndex::UserIndex(size_t expected_users)
+{
+	//keep the table at most half full
+	size_t capacity = 16;
+	while (capacity < expected_users * 2) {
+		capacity *= 2;
+	}
+	slot_keys.assign(capacity, 0);
+	slot_values.assign(capacity, 0);
+	mask = capacity - 1;
+	vertex_user_ids.reserve(expected_users);
+};
+
+size_t UserIndex::slot_for(uint64_t user_id) const
+{
+	size_t slot = hash_id(user_id) & mask;
+	while (slot_keys[slot] != 0 && slot_keys[slot] != user_id) {
+		slot = (slot + 1) & mask;
+	}
+	return slot;
+};
+
+void UserIndex::grow()
+{
+	vector<uint64_t> old_keys = move(slot_keys);
+	vector<uint32_t> old_values = move(slot_values);
+	size_t capacity = old_keys.size() * 2;
+	slot_keys.assign(capacity, 0);
+	slot_values.assign(capacity, 0);
+	mask = capacity - 1;
+	for (size_t i = 0; i < old_keys.size(); i++) {
+		if (old_keys[i] != 0) {
+			size_t slot = slot_for(old_keys[i]);
+			slot_keys[slot] = old_keys[i];
+			slot_values[slot] = old_values[i];
+		}
+	}
+};
+
+uint32_t UserIndex::intern(uint64_t user_id)
+{
+	if (user_id == 0) {
+		throw invalid_argument("User ID 0 is reserved");
+	}
+	size_t slot = slot_for(user_id);
+	if (slot_keys[slot] == user_id) {
+		return slot_values[slot];
+	}
+	if ((vertex_user_ids.size() + 1) * 2 > slot_keys.size()) {
+		grow();
+		slot = slot_for(user_id);
+	}
+	uint32_t vertex = (uint32_t)vertex_user_ids.size();
+	slot_keys[slot] = user_id;
+	slot_values[slot] = vertex;
+	vertex_user_ids.push_back(user_id);
+	return vertex;
+};
+
+int64_t UserIndex::find(uint64_t user_id) const
+{
+	if (user_id == 0) {
+		return -1;
+	}
+	size_t slot = slot_for(user_id);
+	return slot_keys[slot] == user_id ? (int64_t)slot_values[slot] : -1;
+};
@@ -0,0 +1,28 @@
+#pragma once
+#include "utilities.h"
+#include <cstdint>
+
+//maps 64 bit user IDs to dense vertex IDs (0, 1, 2, ... in order of first appearance)
+//open addressing with linear probing over flat arrays, so a lookup is a hash and usually a single cache miss
+//user ID 0 marks an empty slot, which is fine because parse_id never returns a valid id of 0
+class UserIndex
+{
+private:
+	std::vector<uint64_t> slot_keys;
+	std::vector<uint32_t> slot_values;
+	std::vector<uint64_t> vertex_user_ids;	//reverse mapping, vertex ID -> user ID
+	size_t mask = 0;
+
+	void grow();
+	size_t slot_for(uint64_t user_id) const;
+public:
+	UserIndex(size_t expected_users = 1024);
+
+	//returns the vertex ID for user_id, assigning the next one if this is the first time we've seen it
+	uint32_t intern(uint64_t user_id);
+	//returns -1 if the user hasn't been seen
+	int64_t find(uint64_t user_id) const;
+	uint64_t user_id(uint32_t vertex) const { return vertex_user_ids[vertex]; }
+	const std::vector<uint64_t>& user_ids() const { return vertex_user_ids; }
+	size_t size() const { return vertex_user_ids.size(); }
+};
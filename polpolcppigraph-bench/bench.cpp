@@ -0,0 +1,371 @@
+#include "../Crowd.h"
+#include "../utilities.h"
+#include <atomic>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <boost/json.hpp>
+
+using namespace std;
+
+//polpolcppigraph-bench measures how Crowd::is_mk_observer scales on reproducible synthetic graphs
+//every option takes a comma separated list, and every combination is run:
+//  --generators ba,sbm,powerlaw   barabasi-albert, a polarised stochastic block model, static power law with in-degree hubs
+//  --sizes 1000,10000,100000      vertices
+//  --m 1,2,3 --k 2,3              observer parameters
+//  --threads 1,4                  threads checking vertices concurrently, each with its own view of the graph
+//  --engines view,graph           view: non-owning Crowd views of the shared graph, graph: a Crowd that owns a copy (single threaded)
+//                                 the graph engine copies the graph (or its weights) and searches all of it for every pair it tests,
+//                                 so it only runs on graphs of up to --graph-limit vertices and bigger sizes skip it
+//  --weighted 0,1                 edges get a weight of 1-5 interactions, used as path lengths
+//and single values:
+//  --degree 8                     average out-degree of the generated graphs
+//  --sample 1000                  vertices timed per run, picked at random (the same ones every time for a given seed)
+//  --budget 10                    seconds a run may take before it stops timing more vertices. it's checked between vertices,
+//                                 so a run goes over by however long its last vertex takes
+//  --graph-limit 10000            most vertices the graph engine will run on
+//  --seed 1
+//  --output bench                 results go to bench.csv and bench.json
+//the bench project builds Crowd.cpp with POLPOL_CROWD_STATS, so the results break each run down by stage
+//(build with msbuild /p:CrowdTimers=1 to time the stages too)
+
+struct BenchOptions {
+	vector<string> generators = { "ba", "sbm", "powerlaw" };
+	vector<string> sizes = { "1000", "10000", "100000" };
+	vector<string> ms = { "1", "2", "3" };
+	vector<string> ks = { "2", "3" };
+	vector<string> threads = { "1", to_string(max(1u, thread::hardware_concurrency())) };
+	vector<string> engines = { "view", "graph" };
+	vector<string> weighted = { "0", "1" };
+	int degree = 8;
+	size_t sample = 1000;
+	double budget = 10;
+	size_t graph_limit = 10000;
+	unsigned long seed = 1;
+	string output = "bench";
+};
+
+struct BenchResult {
+	string generator;
+	size_t vertices = 0;
+	size_t edges = 0;
+	double generate_seconds = 0;
+	string engine;
+	bool weighted = false;
+	int m = 0;
+	int k = 0;
+	int threads = 0;
+	size_t measured = 0;	//vertices timed before the sample or the budget ran out
+	size_t observers = 0;
+	double seconds = 0;	//wall time for the measured vertices
+	double mean_us = 0;
+	double p50_us = 0;
+	double p99_us = 0;
+	double max_us = 0;
+	double vertices_per_second = 0;
+	CrowdStats stats;	//only counted if Crowd.cpp was built with POLPOL_CROWD_STATS, as the bench project builds it
+};
+
+static vector<string> split_list(const string& list) {
+	vector<string> values;
+	stringstream stream(list);
+	string value;
+	while (getline(stream, value, ',')) {
+		if (!value.empty()) {
+			values.push_back(value);
+		}
+	}
+	return values;
+}
+
+static BenchOptions parse_options(int argc, char* argv[]) {
+	BenchOptions options;
+	for (int i = 1; i + 1 < argc; i += 2) {
+		string name = argv[i];
+		string value = argv[i + 1];
+		if (name == "--generators") options.generators = split_list(value);
+		else if (name == "--sizes") options.sizes = split_list(value);
+		else if (name == "--m") options.ms = split_list(value);
+		else if (name == "--k") options.ks = split_list(value);
+		else if (name == "--threads") options.threads = split_list(value);
+		else if (name == "--engines") options.engines = split_list(value);
+		else if (name == "--weighted") options.weighted = split_list(value);
+		else if (name == "--degree") options.degree = stoi(value);
+		else if (name == "--sample") options.sample = stoull(value);
+		else if (name == "--budget") options.budget = stod(value);
+		else if (name == "--graph-limit") options.graph_limit = stoull(value);
+		else if (name == "--seed") options.seed = stoul(value);
+		else if (name == "--output") options.output = value;
+		else throw invalid_argument("Unknown option " + name);
+	}
+	return options;
+}
+
+//throws if an igraph call failed, rather than timing whatever it left behind
+static void check(igraph_error_t error, const string& what) {
+	if (error != IGRAPH_SUCCESS) {
+		throw runtime_error(what + " failed: " + igraph_strerror(error));
+	}
+}
+
+//generates the named graph on n vertices with igraph's seeded RNG, so the same seed always gives the same graph
+//every edge gets a "weight" of 1-5, whether or not a run uses it
+static void generate_graph(const string& generator, igraph_integer_t n, int degree, unsigned long seed, igraph_t* out) {
+	igraph_rng_seed(igraph_rng_default(), seed);
+	if (generator == "ba") {
+		//new vertices point at old ones, so the early vertices become hubs that hear from a lot of others
+		check(igraph_barabasi_game(out, n, 1, degree, NULL, false, 1, true, IGRAPH_BARABASI_PSUMTREE, NULL), "Generating the ba graph");
+	} else if (generator == "sbm") {
+		//two equal sides that mostly talk among themselves, and a small neutral block that talks to both
+		igraph_vector_int_t block_sizes;
+		igraph_vector_int_init(&block_sizes, 3);
+		VECTOR(block_sizes)[0] = n * 45 / 100;
+		VECTOR(block_sizes)[1] = n * 45 / 100;
+		VECTOR(block_sizes)[2] = n - VECTOR(block_sizes)[0] - VECTOR(block_sizes)[1];
+		double side = max<double>(1, (double)VECTOR(block_sizes)[0]);
+		double neutral = max<double>(1, (double)VECTOR(block_sizes)[2]);
+		double preferences[3][3] = {
+			{ 0.9 * degree / side, 0.02 * degree / side, 0.08 * degree / neutral },
+			{ 0.02 * degree / side, 0.9 * degree / side, 0.08 * degree / neutral },
+			{ 0.4 * degree / side, 0.4 * degree / side, 0.2 * degree / neutral },
+		};
+		igraph_matrix_t pref_matrix;
+		igraph_matrix_init(&pref_matrix, 3, 3);
+		for (int i = 0; i < 3; i++) {
+			for (int j = 0; j < 3; j++) {
+				MATRIX(pref_matrix, i, j) = min(1.0, preferences[i][j]);
+			}
+		}
+		igraph_error_t error = igraph_sbm_game(out, n, &pref_matrix, &block_sizes, true, false);
+		igraph_matrix_destroy(&pref_matrix);
+		igraph_vector_int_destroy(&block_sizes);
+		check(error, "Generating the sbm graph");
+	} else if (generator == "powerlaw") {
+		//heavy tailed in-degree (a few accounts everyone interacts with), lighter tailed out-degree
+		check(igraph_static_power_law_game(out, n, n * degree, 3, 2.1, false, false, true), "Generating the powerlaw graph");
+	} else {
+		throw invalid_argument("Unknown generator " + generator + ", expected ba, sbm or powerlaw");
+	}
+
+	igraph_vector_t weights;
+	igraph_vector_init(&weights, igraph_ecount(out));
+	for (igraph_integer_t e = 0; e < igraph_ecount(out); e++) {
+		VECTOR(weights)[e] = (double)igraph_rng_get_integer(igraph_rng_default(), 1, 5);
+	}
+	igraph_cattribute_EAN_setv(out, "weight", &weights);
+	igraph_vector_destroy(&weights);
+}
+
+static double percentile(const vector<double>& sorted, double fraction) {
+	if (sorted.empty()) {
+		return 0;
+	}
+	return sorted[min(sorted.size() - 1, (size_t)(fraction * sorted.size()))];
+}
+
+//times is_mk_observer on each sampled vertex, spread over the given number of threads
+static BenchResult run_observers(const igraph_t* g, const vector<double>& weights, const vector<uint>& sample, const BenchOptions& options,
+	const string& engine, bool weighted, int m, int k, int threads) {
+	BenchResult result;
+	result.engine = engine;
+	result.weighted = weighted;
+	result.m = m;
+	result.k = k;
+	result.threads = threads;
+
+	vector<vector<double>> latencies(threads);
+	vector<CrowdStats> stats(threads);
+	atomic<size_t> observers = 0;
+	auto deadline = chrono::steady_clock::now() + chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(options.budget));
+	auto start = chrono::steady_clock::now();
+
+	if (engine == "graph") {
+		//the owning crowd destroys its graph, so it gets a copy
+		igraph_t* copy = new igraph_t();
+		check(igraph_copy(copy, g), "Copying the graph");
+		Crowd crowd(copy, weighted);
+		start = chrono::steady_clock::now();
+		for (uint v : sample) {
+			if (chrono::steady_clock::now() > deadline) {
+				break;
+			}
+			auto before = chrono::steady_clock::now();
+			if (crowd.is_mk_observer(v, m, k)) {
+				observers++;
+			}
+			latencies[0].push_back(chrono::duration<double, micro>(chrono::steady_clock::now() - before).count());
+		}
+		stats[0] = crowd.total_stats();
+	} else {
+		vector<size_t> membership(igraph_vcount(g), 0);
+		vector<thread> workers;
+		for (int t = 0; t < threads; t++) {
+			workers.emplace_back([&, t]() {
+				Crowd crowd(g, membership, 0, weighted ? &weights : NULL, weighted);
+				for (size_t i = t; i < sample.size(); i += threads) {
+					if (chrono::steady_clock::now() > deadline) {
+						break;
+					}
+					auto before = chrono::steady_clock::now();
+					if (crowd.is_mk_observer(sample[i], m, k)) {
+						observers++;
+					}
+					latencies[t].push_back(chrono::duration<double, micro>(chrono::steady_clock::now() - before).count());
+				}
+				stats[t] = crowd.total_stats();
+			});
+		}
+		for (thread& worker : workers) {
+			worker.join();
+		}
+	}
+	result.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+	vector<double> all;
+	for (const vector<double>& thread_latencies : latencies) {
+		all.insert(all.end(), thread_latencies.begin(), thread_latencies.end());
+	}
+	sort(all.begin(), all.end());
+	for (const CrowdStats& thread_stats : stats) {
+		result.stats += thread_stats;
+	}
+	result.measured = all.size();
+	result.observers = observers;
+	for (double latency : all) {
+		result.mean_us += latency;
+	}
+	result.mean_us = all.empty() ? 0 : result.mean_us / all.size();
+	result.p50_us = percentile(all, 0.5);
+	result.p99_us = percentile(all, 0.99);
+	result.max_us = all.empty() ? 0 : all.back();
+	result.vertices_per_second = result.seconds > 0 ? result.measured / result.seconds : 0;
+	return result;
+}
+
+static void write_results(const vector<BenchResult>& results, const string& output) {
+	ofstream csv(output + ".csv");
+	csv << "generator,vertices,edges,generate_seconds,engine,weighted,m,k,threads,measured,observers,seconds,mean_us,p50_us,p99_us,max_us,vertices_per_second,"
+		<< "pairs_tested,searches,vertices_expanded,clique_candidates,neighbour_seconds,pair_seconds,search_seconds,clique_seconds\n";
+	for (const BenchResult& r : results) {
+		csv << r.generator << "," << r.vertices << "," << r.edges << "," << r.generate_seconds << "," << r.engine << "," << r.weighted << ","
+			<< r.m << "," << r.k << "," << r.threads << "," << r.measured << "," << r.observers << "," << r.seconds << ","
+			<< r.mean_us << "," << r.p50_us << "," << r.p99_us << "," << r.max_us << "," << r.vertices_per_second << ","
+			<< r.stats.pairs_tested << "," << r.stats.searches << "," << r.stats.vertices_expanded << "," << r.stats.clique_candidates << ","
+			<< r.stats.neighbour_seconds << "," << r.stats.pair_seconds << "," << r.stats.search_seconds << "," << r.stats.clique_seconds << "\n";
+	}
+
+	boost::json::array runs;
+	for (const BenchResult& r : results) {
+		boost::json::object run;
+		run["generator"] = r.generator;
+		run["vertices"] = r.vertices;
+		run["edges"] = r.edges;
+		run["generate_seconds"] = r.generate_seconds;
+		run["engine"] = r.engine;
+		run["weighted"] = r.weighted;
+		run["m"] = r.m;
+		run["k"] = r.k;
+		run["threads"] = r.threads;
+		run["measured"] = r.measured;
+		run["observers"] = r.observers;
+		run["seconds"] = r.seconds;
+		run["mean_us"] = r.mean_us;
+		run["p50_us"] = r.p50_us;
+		run["p99_us"] = r.p99_us;
+		run["max_us"] = r.max_us;
+		run["vertices_per_second"] = r.vertices_per_second;
+		run["pairs_tested"] = r.stats.pairs_tested;
+		run["searches"] = r.stats.searches;
+		run["vertices_expanded"] = r.stats.vertices_expanded;
+		run["clique_candidates"] = r.stats.clique_candidates;
+		run["neighbour_seconds"] = r.stats.neighbour_seconds;
+		run["pair_seconds"] = r.stats.pair_seconds;
+		run["search_seconds"] = r.stats.search_seconds;
+		run["clique_seconds"] = r.stats.clique_seconds;
+		runs.push_back(move(run));
+	}
+	ofstream json(output + ".json", ios_base::out | ios_base::trunc);
+	json << boost::json::serialize(runs) << "\n";
+}
+
+int main(int argc, char* argv[]) {
+	//igraph reports errors through their return codes (see check) instead of aborting
+	igraph_set_error_handler(igraph_error_handler_printignore);
+	igraph_set_attribute_table(&igraph_cattribute_table);
+
+	BenchOptions options;
+	try {
+		options = parse_options(argc, argv);
+	} catch (const exception& e) {
+		cerr << e.what() << endl;
+		return 1;
+	}
+
+	vector<BenchResult> results;
+	for (const string& generator : options.generators) {
+		for (const string& size : options.sizes) {
+			igraph_integer_t n = stoll(size);
+			cout << "Generating " << generator << " graph with " << n << " vertices..." << endl;
+			auto generate_start = chrono::steady_clock::now();
+			igraph_t g;
+			try {
+				generate_graph(generator, n, options.degree, options.seed, &g);
+			} catch (const exception& e) {
+				cerr << e.what() << endl;
+				return 1;
+			}
+			double generate_seconds = chrono::duration<double>(chrono::steady_clock::now() - generate_start).count();
+			cout << igraph_ecount(&g) << " edges in " << generate_seconds << " seconds" << endl;
+
+			vector<double> weights(igraph_ecount(&g));
+			for (igraph_integer_t e = 0; e < igraph_ecount(&g); e++) {
+				weights[e] = EAN(&g, "weight", e);
+			}
+			vector<uint> sample(n);
+			for (uint v = 0; v < sample.size(); v++) {
+				sample[v] = v;
+			}
+			shuffle(sample.begin(), sample.end(), mt19937(options.seed));
+			sample.resize(min<size_t>(sample.size(), options.sample));
+
+			for (const string& engine : options.engines) {
+				//one vertex of the graph engine on a big graph can take longer than any budget, since the budget is checked between vertices
+				if (engine == "graph" && (size_t)n > options.graph_limit) {
+					cout << "Skipping the graph engine on " << n << " vertices, it copies the graph for every pair it tests and is limited to "
+						<< options.graph_limit << " (--graph-limit)" << endl;
+					continue;
+				}
+				for (const string& weighted : options.weighted) {
+					for (const string& m : options.ms) {
+						for (const string& k : options.ks) {
+							for (const string& threads : options.threads) {
+								//the owning crowd is only ever used from one thread
+								if (engine == "graph" && threads != "1") {
+									continue;
+								}
+								BenchResult result = run_observers(&g, weights, sample, options, engine, weighted == "1", stoi(m), stoi(k), stoi(threads));
+								result.generator = generator;
+								result.vertices = n;
+								result.edges = igraph_ecount(&g);
+								result.generate_seconds = generate_seconds;
+								cout << generator << " n=" << n << " " << engine << (result.weighted ? " weighted" : "") << " (" << m << "," << k << ") "
+									<< threads << " threads: " << result.measured << " vertices, " << result.observers << " observers, mean "
+									<< result.mean_us << "us, p99 " << result.p99_us << "us, " << result.vertices_per_second << " vertices/s" << endl;
+								results.push_back(result);
+								//written as we go, so a long sweep that gets killed still leaves everything before it
+								write_results(results, options.output);
+							}
+						}
+					}
+				}
+			}
+			igraph_destroy(&g);
+		}
+	}
+	cout << "Results written to " << options.output << ".csv and " << options.output << ".json" << endl;
+	return 0;
+}
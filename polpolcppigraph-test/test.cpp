@@ -1,8 +1,50 @@
 #include "pch.h"
 #include "../Crowd.h"
+#include "../IdSet.h"
+#include "../UserIndex.h"
+#include "../GraphBuilder.h"
+#include "../EdgeAccumulator.h"
+#include "../ExternalGraphBuilder.h"
+#include "../GraphSnapshot.h"
+#include "../GraphPruning.h"
+#include "../CommunityDetection.h"
+#include "../CommunityObservers.h"
+#include "../Profiler.h"
+#include "../TweetStore.h"
+#include "../TermStatistics.h"
+#include "../InteractionLayers.h"
+#include "../DocumentSource.h"
+#include "../Uploader.h"
+#include "../Checkpoint.h"
+#include "../QueryPredicate.h"
+#include "../SlidingWindows.h"
+#include "../Dates.h"
+#include <fstream>
+#include <filesystem>
+#include <iomanip>
+#include <map>
+#include <set>
+#include <sstream>
+#include <tuple>
+#include <bsoncxx/builder/basic/document.hpp>
+#include <mongocxx/instance.hpp>
 #include "../utilities.h"   //included for the windows exception handler
 #include <gtest/gtest.h>
 
+//every edge of g by (user ID, connected user ID), with its weight followed by its weight in each layer
+//so graphs built different ways can be compared whatever order their vertices and edges are in
+static std::map<std::pair<uint64_t, uint64_t>, std::vector<double>> edge_weights(igraph_t* g, const UserIndex& users) {
+    std::map<std::pair<uint64_t, uint64_t>, std::vector<double>> edges;
+    for (igraph_integer_t e = 0; e < igraph_ecount(g); e++) {
+        std::vector<double>& weights = edges[{ users.user_id(IGRAPH_FROM(g, e)), users.user_id(IGRAPH_TO(g, e)) }];
+        weights.push_back(EAN(g, "weight", e));
+        for (const std::string& attribute : layer_attributes()) {
+            weights.push_back(EAN(g, attribute.c_str(), e));
+        }
+    }
+    return edges;
+}
+
 class CrowdTest : public ::testing::Test, public ::testing::WithParamInterface<int> {
 public:
 	igraph_t* __construct_test_crowd_ab_only() {
@@ -87,8 +129,10 @@ public:
 	void SetUp() override {
         //prevent igraph from killing everything on error. igraph fucntions will return error codes instead
         igraph_set_error_handler(igraph_error_handler_ignore);
+#ifdef _WIN32
         //prevent windows from killing everything on error. windows errors will throw regular exceptions instead
         _set_se_translator(sehTranslator);
+#endif
         //allows the use of vertex and edge attributes
         //this is needed because the igraph attribute features are more intended to be used with Python and R than C++
         igraph_set_attribute_table(&igraph_cattribute_table);
@@ -167,4 +211,943 @@ TEST_F(CrowdTest, florentinegraphtests) {
 	for (unsigned char m = 4; m < 6; m++) {
 		EXPECT_FALSE(c->is_mk_observer(1, m, k)); //FALSE: ...as above, can't find any 5 nodes w/4-deg-of-separation minimum
 	}
-}
\ No newline at end of file
+}
+
+TEST_F(CrowdTest, communityviewtests) {
+    // 0-1-2-3-4-5-6-7, with 0-3 and 4-7 as the two communities
+    igraph_t* g = new igraph_t();
+    igraph_empty(g, 8, false);
+    for (int v = 0; v < 7; v++) {
+        igraph_add_edge(g, v, v + 1);
+    }
+    std::vector<size_t> membership = { 0, 0, 0, 0, 1, 1, 1, 1 };
+    {
+        //across the whole graph 3 hears from 2 and 4, but its community only reaches it through 2
+        Crowd view(g, membership, 0);
+        EXPECT_TRUE(view.is_mk_observer(2, 1, 2));
+        EXPECT_FALSE(view.is_mk_observer(3, 1, 2));
+        EXPECT_FALSE(view.is_mk_observer(5, 1, 2));
+    }
+    //the view leaves the graph alone
+    EXPECT_EQ(igraph_vcount(g), 8);
+
+    std::vector<CommunityObservers> communities = community_observers(g, membership, 1, 2);
+    ASSERT_EQ(communities.size(), 2);
+    EXPECT_EQ(communities[0].observers, std::vector<uint32_t>({ 1, 2 }));
+    EXPECT_EQ(communities[1].observers, std::vector<uint32_t>({ 5, 6 }));
+
+    Crowd whole(g);
+    EXPECT_TRUE(whole.is_mk_observer(3, 1, 2));
+}
+
+TEST_F(CrowdTest, edgeweightsmatchedges) {
+    igraph_t* g = __construct_test_crowd_5nodes();
+    EXPECT_THROW(Crowd(g, std::vector<double>(5, 1.0)), std::invalid_argument);
+    EXPECT_THROW(Crowd(g, std::vector<double>(7, 1.0)), std::invalid_argument);
+    //dropping 3->4 and 4->3 cuts 4 off, so 3 only hears from 2
+    Crowd c(g, std::vector<double>({ 1, 1, 1, 0, 0, 1 }));
+    EXPECT_FALSE(c.is_mk_observer(3, 1, 2));
+}
+
+TEST_F(CrowdTest, statscountstages) {
+    Crowd* c = new Crowd(__construct_test_crowd_5nodes());
+    c->is_mk_observer(3, 1, 2);
+    c->is_mk_observer(3, 1, 3);
+    CrowdStats last = c->last_call_stats();
+    CrowdStats total = c->total_stats();
+    if (Crowd::counts_stats()) {
+        //3 hears from 2 and 4: one pair, searched both ways
+        EXPECT_EQ(last.calls, 1);
+        EXPECT_EQ(last.neighbours, 2);
+        EXPECT_EQ(last.pairs_tested, 1);
+        EXPECT_EQ(last.searches, 2);
+        EXPECT_EQ(total.calls, 2);
+        EXPECT_EQ(total.searches, 4);
+    } else {
+        //compiled out
+        EXPECT_EQ(total.calls, 0);
+    }
+    c->reset_stats();
+    EXPECT_EQ(c->total_stats().calls, 0);
+    EXPECT_EQ(c->total_stats().searches, 0);
+    EXPECT_EQ(c->last_call_stats().calls, 0);
+}
+
+TEST(CrowdStatsTest, addseverystage) {
+    //checked directly, so the sums are covered whatever Crowd.cpp was built with
+    CrowdStats a;
+    a.calls = 1;
+    a.neighbours = 2;
+    a.pairs_tested = 3;
+    a.searches = 4;
+    a.vertices_expanded = 5;
+    a.clique_candidates = 6;
+    a.cliques_grown = 7;
+    a.neighbour_seconds = 0.5;
+    a.pair_seconds = 1.5;
+    a.search_seconds = 2.5;
+    a.clique_seconds = 3.5;
+    CrowdStats total;
+    total += a;
+    total += a;
+    EXPECT_EQ(total.calls, 2);
+    EXPECT_EQ(total.neighbours, 4);
+    EXPECT_EQ(total.pairs_tested, 6);
+    EXPECT_EQ(total.searches, 8);
+    EXPECT_EQ(total.vertices_expanded, 10);
+    EXPECT_EQ(total.clique_candidates, 12);
+    EXPECT_EQ(total.cliques_grown, 14);
+    EXPECT_DOUBLE_EQ(total.neighbour_seconds, 1);
+    EXPECT_DOUBLE_EQ(total.pair_seconds, 3);
+    EXPECT_DOUBLE_EQ(total.search_seconds, 5);
+    EXPECT_DOUBLE_EQ(total.clique_seconds, 7);
+    //adding nothing changes nothing
+    total += CrowdStats();
+    EXPECT_EQ(total.calls, 2);
+    EXPECT_DOUBLE_EQ(total.clique_seconds, 7);
+}
+
+TEST(CrowdStatsTest, countsviewsearches) {
+    //0 - 1 - 2 - 3 - 4 - 5, seen whole through a view. the test project builds Crowd.cpp with POLPOL_CROWD_STATS
+    ASSERT_TRUE(Crowd::counts_stats());
+    igraph_t* g = new igraph_t();
+    igraph_empty(g, 6, false);
+    for (int v = 0; v < 5; v++) {
+        igraph_add_edge(g, v, v + 1);
+    }
+    std::vector<size_t> membership(6, 0);
+    {
+        Crowd view(g, membership, 0);
+        //2 hears from 1 and 3. with m = 1 each search stops at the cutoff after expanding only where it started
+        EXPECT_TRUE(view.is_mk_observer(2, 1, 2));
+        CrowdStats last = view.last_call_stats();
+        EXPECT_EQ(last.calls, 1);
+        EXPECT_EQ(last.neighbours, 2);
+        EXPECT_EQ(last.pairs_tested, 1);
+        EXPECT_EQ(last.searches, 2);
+        EXPECT_EQ(last.vertices_expanded, 2);
+        //with m = 3 the searches run out of vertices instead: 3, 4 and 5 one way, 1 and 0 the other
+        EXPECT_TRUE(view.is_mk_observer(2, 3, 2));
+        last = view.last_call_stats();
+        EXPECT_EQ(last.pairs_tested, 1);
+        EXPECT_EQ(last.searches, 2);
+        EXPECT_EQ(last.vertices_expanded, 5);
+        //0 only hears from 1, too few to pair
+        EXPECT_FALSE(view.is_mk_observer(0, 1, 2));
+        last = view.last_call_stats();
+        EXPECT_EQ(last.neighbours, 1);
+        EXPECT_EQ(last.pairs_tested, 0);
+        EXPECT_EQ(last.searches, 0);
+        CrowdStats total = view.total_stats();
+        EXPECT_EQ(total.calls, 3);
+        EXPECT_EQ(total.neighbours, 5);
+        EXPECT_EQ(total.pairs_tested, 2);
+        EXPECT_EQ(total.searches, 4);
+        EXPECT_EQ(total.vertices_expanded, 7);
+    }
+    igraph_destroy(g);
+    delete g;
+}
+
+TEST(IdSetTest, parseid) {
+    EXPECT_EQ(parse_id("1238126417466744832"), 1238126417466744832ULL);
+    //anything that isn't an id comes back empty rather than as an id of 0 that would go into the sets
+    EXPECT_EQ(parse_id(""), std::nullopt);
+    EXPECT_EQ(parse_id("12ab"), std::nullopt);
+    EXPECT_EQ(parse_id("-5"), std::nullopt);
+    EXPECT_EQ(parse_id("0"), std::nullopt);
+    EXPECT_EQ(parse_id("18446744073709551616"), std::nullopt);
+}
+
+TEST(IdSetTest, concurrentinsert) {
+    //every id is inserted by two threads, only one of them should "win" each time
+    ConcurrentIdSet ids;
+    std::atomic<int> wins = 0;
+    auto insert_all = [&ids, &wins]() {
+        for (uint64_t id = 1; id <= 100000; id++) {
+            if (ids.insert(id)) {
+                wins++;
+            }
+        }
+    };
+    std::thread t1(insert_all);
+    std::thread t2(insert_all);
+    t1.join();
+    t2.join();
+    EXPECT_EQ(wins, 100000);
+    EXPECT_EQ(ids.size(), 100000);
+    EXPECT_TRUE(ids.contains(50000));
+    EXPECT_FALSE(ids.contains(100001));
+}
+
+TEST(UserIndexTest, internandgrow) {
+    //start tiny so the table has to grow several times
+    UserIndex index(1);
+    for (uint64_t i = 0; i < 10000; i++) {
+        EXPECT_EQ(index.intern(1000000000000ULL + i * 4096), i);
+    }
+    EXPECT_EQ(index.size(), 10000);
+    //interning again gives the same vertex
+    EXPECT_EQ(index.intern(1000000000000ULL + 5 * 4096), 5);
+    EXPECT_EQ(index.size(), 10000);
+    EXPECT_EQ(index.find(1000000000000ULL + 9999 * 4096), 9999);
+    EXPECT_EQ(index.find(42), -1);
+    EXPECT_EQ(index.user_id(7), 1000000000000ULL + 7 * 4096);
+    EXPECT_THROW(index.intern(0), std::invalid_argument);
+}
+
+TEST(GraphBuilderTest, mergematchesserial) {
+    //the same interactions, read in one go or split into two time ranges and merged, should give the same graph
+    std::vector<std::pair<uint64_t, uint64_t>> interactions = {
+        {10, 20}, {20, 30}, {10, 20}, {40, 10}, {30, 40}, {50, 10}, {20, 30}, {10, 20}, {60, 50}
+    };
+    GraphBuilder serial;
+    for (const auto& [user, connected_user] : interactions) {
+        serial.add(user, connected_user, "tweet");
+    }
+    std::vector<ptr<GraphBuilder>> parts = { _ptr<GraphBuilder>(), _ptr<GraphBuilder>() };
+    for (size_t i = 0; i < interactions.size(); i++) {
+        parts[i < 4 ? 0 : 1]->add(interactions[i].first, interactions[i].second, "tweet");
+    }
+    ptr<GraphBuilder> merged = GraphBuilder::merge(parts);
+
+    EXPECT_EQ(merged->users->user_ids(), serial.users->user_ids());
+    EXPECT_EQ(merged->edges->keys(), serial.edges->keys());
+    EXPECT_EQ(merged->edges->weights(), serial.edges->weights());
+    merged->tweets->seal(merged->users->size());
+    EXPECT_EQ(merged->tweets->tweet_count(0), 3);
+    //self interactions and missing users are skipped
+    EXPECT_FALSE(serial.add(10, 10, "tweet"));
+    EXPECT_FALSE(serial.add(0, 10, "tweet"));
+}
+
+TEST(ExternalGraphBuilderTest, matchesgraphbuilder) {
+    //enough interactions for several runs and more than one merge pass, checked edge by edge (by user ID) against GraphBuilder
+    GraphBuilder in_memory;
+    ExternalGraphBuilder out_of_core("external_graph_test", 0, 2);
+    for (uint64_t i = 0; i < 5000; i++) {
+        uint64_t user = 100 + (i * 7919) % 97;
+        uint64_t connected_user = 100 + (i * 104729) % 89;
+        InteractionLayer layer = (InteractionLayer)(i % interaction_layer_count);
+        EXPECT_EQ(out_of_core.add(user, connected_user, layer), in_memory.add(user, connected_user, "", layer));
+    }
+    igraph_t expected, actual;
+    in_memory.build(&expected);
+    UserIndex users;
+    out_of_core.build(&actual, users);
+    EXPECT_GT(out_of_core.run_count(), 8);
+    EXPECT_TRUE(std::filesystem::is_empty("external_graph_test"));
+
+    EXPECT_EQ(users.size(), in_memory.users->size());
+    EXPECT_EQ(edge_weights(&actual, users), edge_weights(&expected, *in_memory.users));
+    for (size_t v = 1; v < users.size(); v++) {
+        EXPECT_LT(users.user_id(v - 1), users.user_id(v));
+    }
+    igraph_destroy(&expected);
+    igraph_destroy(&actual);
+    std::filesystem::remove_all("external_graph_test");
+}
+
+TEST(ExternalGraphBuilderTest, countssaturate) {
+    //counts summed within a run, across runs and across layers stop at the largest count instead of wrapping
+    ExternalGraphBuilder builder("external_saturate_test", 0, 2);
+    for (int i = 0; i < 3000; i++) {
+        builder.add(10, 20, InteractionLayer::Retweet, UINT32_MAX / 2);
+    }
+    builder.add(10, 20, InteractionLayer::Reply, 3);
+    builder.add(20, 10, InteractionLayer::Quote);
+    igraph_t g;
+    UserIndex users;
+    igraph_vector_t weights;
+    igraph_vector_init(&weights, 0);
+    builder.build(&g, users, &weights);
+    EXPECT_GT(builder.run_count(), 2);
+    ASSERT_EQ(igraph_vector_size(&weights), 2);
+    std::vector<std::string> attributes = layer_attributes();
+    //users 10 and 20 are vertices 0 and 1, and the edges come out in (source, target) order
+    EXPECT_EQ(VECTOR(weights)[0], UINT32_MAX);
+    EXPECT_EQ(EAN(&g, attributes[(size_t)InteractionLayer::Retweet].c_str(), 0), UINT32_MAX);
+    EXPECT_EQ(EAN(&g, attributes[(size_t)InteractionLayer::Reply].c_str(), 0), 3);
+    EXPECT_EQ(VECTOR(weights)[1], 1);
+    EXPECT_EQ(EAN(&g, attributes[(size_t)InteractionLayer::Quote].c_str(), 1), 1);
+    igraph_vector_destroy(&weights);
+    igraph_destroy(&g);
+    std::filesystem::remove_all("external_saturate_test");
+}
+
+TEST(GraphSnapshotTest, roundtripandrejects) {
+    GraphBuilder builder;
+    builder.add(10, 20, "a", InteractionLayer::Retweet);
+    builder.add(10, 20, "b", InteractionLayer::Reply);
+    builder.add(20, 30, "c", InteractionLayer::Quote);
+    builder.add(40, 10, "d", InteractionLayer::Retweet);
+    builder.add(40, 10, "e", InteractionLayer::Retweet);
+    igraph_t saved;
+    builder.build(&saved);
+    std::string path = GraphSnapshot::path_for("snapshot_test", 42);
+    GraphSnapshot::save(path, 42, &saved, *builder.users);
+
+    {
+        GraphSnapshot snapshot(path);
+        EXPECT_EQ(snapshot.query_hash(), 42);
+        EXPECT_EQ(snapshot.layer_count(), interaction_layer_count);
+        igraph_t loaded;
+        snapshot.to_igraph(&loaded);
+        ptr<UserIndex> users = snapshot.to_user_index();
+        EXPECT_EQ(users->user_ids(), builder.users->user_ids());
+        EXPECT_EQ(igraph_ecount(&loaded), igraph_ecount(&saved));
+        EXPECT_EQ(edge_weights(&loaded, *users), edge_weights(&saved, *builder.users));
+        igraph_destroy(&loaded);
+    }
+    igraph_destroy(&saved);
+
+    auto rewrite = [&path](size_t offset, const void* bytes, size_t length) {
+        std::fstream file(path, std::ios_base::in | std::ios_base::out | std::ios_base::binary);
+        file.seekp(offset);
+        file.write(static_cast<const char*>(bytes), length);
+    };
+    //a flipped payload byte fails the checksum
+    uint64_t first_user_id = 10 ^ 0xff;
+    rewrite(sizeof(GraphSnapshot::Header), &first_user_id, sizeof(first_user_id));
+    EXPECT_THROW(GraphSnapshot snapshot(path), std::runtime_error);
+    first_user_id = 10;
+    rewrite(sizeof(GraphSnapshot::Header), &first_user_id, sizeof(first_user_id));
+    EXPECT_NO_THROW(GraphSnapshot snapshot(path));
+    //as does a snapshot from another format version
+    uint32_t version = GraphSnapshot::format_version + 1;
+    rewrite(offsetof(GraphSnapshot::Header, version), &version, sizeof(version));
+    EXPECT_THROW(GraphSnapshot snapshot(path), std::runtime_error);
+    std::filesystem::remove_all("snapshot_test");
+}
+
+TEST(DocumentSourceTest, bsondumpbuildsgraph) {
+    using bsoncxx::builder::basic::kvp;
+    using bsoncxx::builder::basic::make_document;
+    //a tiny mongodump style file: 1->2 twice, 2->3 once, one self interaction that should be skipped
+    std::vector<bsoncxx::document::value> docs;
+    docs.push_back(make_document(kvp("user", "1"), kvp("connected_user", "2"), kvp("text", "a")));
+    docs.push_back(make_document(kvp("user", "1"), kvp("connected_user", "2"), kvp("text", "short"), kvp("truncated", true),
+        kvp("extended_tweet", make_document(kvp("full_text", "the full text")))));
+    docs.push_back(make_document(kvp("user", "2"), kvp("connected_user", "3"), kvp("text", "c")));
+    docs.push_back(make_document(kvp("user", "3"), kvp("connected_user", "3"), kvp("text", "d")));
+    std::string path = "documentsource_test.bson";
+    {
+        std::ofstream out(path, std::ios_base::binary);
+        for (const auto& doc : docs) {
+            out.write(reinterpret_cast<const char*>(doc.view().data()), doc.view().length());
+        }
+    }
+
+    GraphBuilder builder;
+    {
+        ptr<DocumentSource> source = open_document_source(path);
+        source->for_each([&builder](const bsoncxx::document::view& doc) {
+            builder.add(doc);
+        });
+    }
+    std::remove(path.c_str());
+
+    EXPECT_EQ(builder.users->size(), 3);
+    EXPECT_EQ(builder.edges->keys(), std::vector<uint64_t>({ EdgeAccumulator::pack(0, 1), EdgeAccumulator::pack(1, 2) }));
+    EXPECT_EQ(builder.edges->weights(), std::vector<uint32_t>({ 2, 1 }));
+    builder.tweets->seal(builder.users->size());
+    EXPECT_EQ(builder.tweets->tweets(0)[1], "the full text");
+}
+
+TEST(GraphBuilderTest, groupsmatchinteractions) {
+    using bsoncxx::builder::basic::kvp;
+    using bsoncxx::builder::basic::make_document;
+    //what the edge pipeline's $group gives back for 1->2 (2 retweets, 1 reply) and 2->3 (1 quote),
+    //with 1->2's retweets split across two groups as they are when some user IDs are stored as numbers
+    auto group = [](auto user, auto connected_user, const char* connection_type, int interactions) {
+        return make_document(kvp("_id", make_document(kvp("user", user), kvp("connected_user", connected_user),
+            kvp("connection_type", connection_type))), kvp("interactions", interactions));
+    };
+    GraphBuilder grouped;
+    EXPECT_TRUE(grouped.add_group(group("1", "2", "retweet", 1).view()));
+    EXPECT_TRUE(grouped.add_group(group(int64_t(1), "2", "retweet", 1).view()));
+    EXPECT_TRUE(grouped.add_group(group("1", "2", "reply", 1).view()));
+    EXPECT_TRUE(grouped.add_group(group("2", "3", "quote", 1).view()));
+    EXPECT_FALSE(grouped.add_group(group("3", "3", "quote", 4).view()));
+
+    GraphBuilder serial;
+    serial.add(1, 2, "a", InteractionLayer::Retweet);
+    serial.add(1, 2, "b", InteractionLayer::Retweet);
+    serial.add(1, 2, "c", InteractionLayer::Reply);
+    serial.add(2, 3, "d", InteractionLayer::Quote);
+
+    EXPECT_EQ(grouped.users->user_ids(), serial.users->user_ids());
+    EXPECT_EQ(grouped.edges->keys(), serial.edges->keys());
+    EXPECT_EQ(grouped.edges->weights(), serial.edges->weights());
+    EXPECT_EQ(grouped.edges->layer_weights(), serial.edges->layer_weights());
+}
+
+TEST(EdgeAccumulatorTest, countssaturate) {
+    //counted and single interactions of every layer are folded together, and totals stop at the largest count instead of wrapping
+    EdgeAccumulator edges(4, 2);
+    edges.add(1, 2, 0, UINT32_MAX - 1);
+    edges.add(1, 2, 0, 5);
+    edges.add(1, 2, 1);
+    edges.add(1, 2, 1, 3);
+    edges.add(1, 2, 0, UINT32_MAX);
+    edges.add(0, 1, 1);
+    EXPECT_EQ(edges.keys(), std::vector<uint64_t>({ EdgeAccumulator::pack(0, 1), EdgeAccumulator::pack(1, 2) }));
+    EXPECT_EQ(edges.weights(), std::vector<uint32_t>({ 1, UINT32_MAX }));
+    EXPECT_EQ(edges.layer_weights(), std::vector<uint32_t>({ 0, 1, UINT32_MAX, 4 }));
+}
+
+TEST(EdgeAccumulatorTest, manyrunsmatchcounts) {
+    //a tiny buffer makes over a thousand runs while the set of edges keeps growing and old edges keep coming back
+    EdgeAccumulator edges(16, 3);
+    std::map<uint64_t, std::vector<uint32_t>> expected;
+    uint32_t state = 1;
+    for (uint32_t i = 0; i < 20000; i++) {
+        state = state * 1103515245 + 12345;
+        uint32_t source = (state >> 8) % (i / 20 + 2);
+        uint32_t target = (state >> 20) % 50;
+        size_t layer = i % 3;
+        edges.add(source, target, layer);
+        std::vector<uint32_t>& counts = expected[EdgeAccumulator::pack(source, target)];
+        counts.resize(4);
+        counts[0]++;
+        counts[1 + layer]++;
+    }
+    std::vector<uint64_t> keys;
+    std::vector<uint32_t> weights;
+    std::vector<uint32_t> layer_weights;
+    for (const auto& [key, counts] : expected) {
+        keys.push_back(key);
+        weights.push_back(counts[0]);
+        layer_weights.insert(layer_weights.end(), counts.begin() + 1, counts.end());
+    }
+    EXPECT_EQ(edges.keys(), keys);
+    EXPECT_EQ(edges.weights(), weights);
+    EXPECT_EQ(edges.layer_weights(), layer_weights);
+}
+
+TEST(SpillStoreTest, roundtripandtruncation) {
+    using bsoncxx::builder::basic::kvp;
+    using bsoncxx::builder::basic::make_document;
+    std::string directory = "spill_test";
+    SpillStore store(directory);
+    UploadBatch batch;
+    batch.collection = "tweets";
+    for (int i = 0; i < 3; i++) {
+        batch.documents.push_back(make_document(kvp("_id", std::to_string(i)), kvp("text", "tweet " + std::to_string(i))));
+        batch.bytes += batch.documents.back().view().length();
+    }
+    store.spill(batch);
+    store.spill(batch);
+    EXPECT_EQ(store.pending(), 2);
+
+    SpillFile first;
+    ASSERT_TRUE(store.take(first));
+    ptr<UploadBatch> loaded = store.load(first);
+    EXPECT_EQ(loaded->collection, "tweets");
+    EXPECT_EQ(loaded->bytes, batch.bytes);
+    ASSERT_EQ(loaded->documents.size(), 3);
+    for (size_t i = 0; i < 3; i++) {
+        EXPECT_TRUE(loaded->documents[i].view() == batch.documents[i].view());
+    }
+    store.remove(first);
+    EXPECT_FALSE(std::filesystem::exists(first.path));
+
+    //a spill file cut short (eg. by a full disk) is reported rather than replayed, whether or not its recorded size agrees
+    SpillFile second;
+    ASSERT_TRUE(store.take(second));
+    EXPECT_FALSE(store.take(first));
+    std::filesystem::resize_file(second.path, batch.bytes - 10);
+    EXPECT_THROW(store.load(second), std::runtime_error);
+    second.bytes = batch.bytes - 10;
+    EXPECT_THROW(store.load(second), std::runtime_error);
+    store.remove(second);
+    std::filesystem::remove_all(directory);
+}
+
+TEST(CheckpointTest, roundtripandcorruption) {
+    std::string path = "checkpoint_test.json";
+    std::filesystem::remove(path);
+    IngestCheckpoint missing(path);
+    EXPECT_FALSE(missing.load());
+
+    IngestCheckpoint saved(path);
+    saved.complete_file("a.json.gz");
+    saved.current_file = "b.json.gz";
+    saved.offset = 5000000000ULL;   //past 32 bits
+    saved.tweets_processed = 1234;
+    saved.users_processed = 567;
+    saved.save();
+    EXPECT_FALSE(std::filesystem::exists(path + ".tmp"));
+
+    //a later run resumes where the last one stopped: completed files are skipped and the current one picks up at the offset
+    IngestCheckpoint loaded(path);
+    ASSERT_TRUE(loaded.load());
+    EXPECT_EQ(loaded.completed_files, std::set<std::string>({ "a.json.gz" }));
+    EXPECT_EQ(loaded.current_file, "b.json.gz");
+    EXPECT_EQ(loaded.offset, 5000000000ULL);
+    EXPECT_EQ(loaded.tweets_processed, 1234);
+    EXPECT_EQ(loaded.users_processed, 567);
+    EXPECT_TRUE(loaded.is_completed("a.json.gz"));
+    EXPECT_FALSE(loaded.is_completed("b.json.gz"));
+    EXPECT_EQ(loaded.resume_offset("b.json.gz"), 5000000000ULL);
+    EXPECT_EQ(loaded.resume_offset("c.json.gz"), 0);
+    loaded.complete_file("b.json.gz");
+    loaded.save();
+
+    IngestCheckpoint resumed(path);
+    ASSERT_TRUE(resumed.load());
+    EXPECT_EQ(resumed.completed_files, std::set<std::string>({ "a.json.gz", "b.json.gz" }));
+    EXPECT_EQ(resumed.resume_offset("b.json.gz"), 0);
+
+    //a checkpoint cut short, or with a field missing or mangled, is rejected and leaves what was loaded before alone
+    std::string contents;
+    {
+        std::ifstream in(path);
+        std::stringstream text;
+        text << in.rdbuf();
+        contents = text.str();
+    }
+    std::vector<std::string> corrupt = {
+        contents.substr(0, contents.size() / 2),
+        "",
+        "{\"completed_files\":[],\"current_file\":\"c.json.gz\",\"tweets_processed\":0,\"users_processed\":0}",
+        "{\"completed_files\":[],\"current_file\":\"c.json.gz\",\"offset\":-1,\"tweets_processed\":0,\"users_processed\":0}",
+        "{\"completed_files\":\"a.json.gz\",\"current_file\":\"c.json.gz\",\"offset\":0,\"tweets_processed\":0,\"users_processed\":0}"
+    };
+    for (const std::string& text : corrupt) {
+        {
+            std::ofstream out(path, std::ios_base::out | std::ios_base::trunc);
+            out << text;
+        }
+        EXPECT_THROW(resumed.load(), std::runtime_error) << text;
+        EXPECT_EQ(resumed.completed_files.size(), 2);
+        EXPECT_EQ(resumed.current_file, "");
+    }
+    resumed.remove();
+    EXPECT_FALSE(std::filesystem::exists(path));
+}
+
+TEST(BulkUploaderTest, flushesunderatinybudget) {
+    using bsoncxx::builder::basic::kvp;
+    using bsoncxx::builder::basic::make_document;
+    static mongocxx::instance inst{};
+    std::string directory = "spill_uploader_test";
+    size_t pushed = 0;
+    {
+        //nothing listens on port 1, so every batch fails fast; what matters is that each one gets to a writer
+        //a budget below the batch size spills every batch, and they must still all be replayed for flush() to return
+        BulkUploader uploader("mongodb://127.0.0.1:1/?serverSelectionTimeoutMS=50&connectTimeoutMS=50", "polpol_test", 1, 2, 1024, 0, 1, directory);
+        for (int i = 0; i < 50; i++) {
+            uploader.push("tweets", make_document(kvp("_id", std::to_string(i)), kvp("text", std::string(100, 'x'))));
+            pushed++;
+        }
+        uploader.flush();
+        EXPECT_EQ(uploader.inserted() + uploader.failed(), pushed);
+        EXPECT_GT(uploader.batches(), 1);
+        uploader.finish();
+    }
+    std::filesystem::remove_all(directory);
+}
+
+TEST(BulkUploaderTest, spillsoverbudget) {
+    using bsoncxx::builder::basic::kvp;
+    using bsoncxx::builder::basic::make_document;
+    static mongocxx::instance inst{};
+    std::string directory = "spill_budget_test";
+    size_t pushed = 0;
+    {
+        //the queue holds the whole 8KB budget rather than the single batch queue_depth asks for, so the parsers run ahead of the
+        //one slow writer until the budget is used up, and then the batches go to disk instead of the parsers waiting
+        BulkUploader uploader("mongodb://127.0.0.1:1/?serverSelectionTimeoutMS=50&connectTimeoutMS=50", "polpol_test", 1, 1, 1024, 0, 8 * 1024, directory);
+        for (int i = 0; i < 200; i++) {
+            uploader.push("tweets", make_document(kvp("_id", std::to_string(i)), kvp("text", std::string(100, 'x'))));
+            pushed++;
+        }
+        EXPECT_GT(uploader.spilled(), 0);
+        uploader.flush();
+        EXPECT_EQ(uploader.inserted() + uploader.failed(), pushed);
+        EXPECT_LT(uploader.peak_resident(), 8 * 1024 + 2 * 1024);
+        uploader.finish();
+    }
+    std::filesystem::remove_all(directory);
+}
+
+TEST(DateTest, parsesutcandoffsets) {
+    const int64_t march_first = 1583020800000LL;
+    EXPECT_EQ(parse_iso_date("1970-01-01T00:00:00Z"), 0);
+    EXPECT_EQ(parse_iso_date("2020-03-01T00:00:00Z"), march_first);
+    EXPECT_EQ(parse_iso_date("2020-03-01"), march_first);
+    EXPECT_EQ(parse_iso_date("2020-03-01T00:00:00.250Z"), march_first + 250);
+    EXPECT_EQ(parse_iso_date("2020-03-01T00:00:00.5"), march_first + 500);
+    //the default mode's query dates are read the same way as local's --from and --to, as UTC
+    EXPECT_EQ(createBsonDateFromString("2020-03-01 00:00:00").to_int64(), march_first);
+    //offsets say how far the written time is ahead of UTC
+    EXPECT_EQ(parse_iso_date("2020-03-01T02:00:00+02:00"), march_first);
+    EXPECT_EQ(parse_iso_date("2020-02-29T19:00:00-0500"), march_first);
+    EXPECT_EQ(parse_iso_date("2020-03-01T05:30:00.000+05:30"), march_first);
+    EXPECT_EQ(format_iso_date(march_first), "2020-03-01T00:00:00Z");
+    std::tm tm = {};
+    std::istringstream twitter("Sun Mar 01 00:00:00 +0000 2020");
+    twitter >> std::get_time(&tm, "%a %b %d %H:%M:%S +0000 %Y");
+    EXPECT_EQ(utc_milliseconds(tm), march_first);
+
+    for (const char* malformed : { "", "2020-3-01", "2020/03/01", "2020-03-01T00:00", "2020-03-01T00-00-00Z", "2020-03-01x00:00:00",
+        "2020-13-01", "2021-02-29", "2020-04-31", "2020-03-01T24:00:00Z", "2020-03-01T00:60:00Z", "2020-03-01T00:00:00.Z",
+        "2020-03-01T00:00:00X", "2020-03-01T00:00:00+2", "2020-03-01T00:00:00+24:00", "2020-03-01T00:00:00Zjunk", "-020-03-01", "2020-03-01 " }) {
+        EXPECT_THROW(parse_iso_date(malformed), std::invalid_argument) << malformed;
+    }
+}
+
+TEST(QueryPredicateTest, datesandexists) {
+    using bsoncxx::builder::basic::kvp;
+    using bsoncxx::builder::basic::make_document;
+    QueryPredicate filter(boost::json::parse(R"({"$and": [
+        {"datetime": {"$gte": {"$date": "2020-03-01T00:00:00Z"}, "$lt": {"$date": "2020-03-15T00:00:00Z"}}},
+        {"connected_user": {"$exists": true}},
+        {"user.lang": {"$ne": "de"}}
+    ]})"));
+    auto in_range = bsoncxx::types::b_date(std::chrono::milliseconds(parse_iso_date("2020-03-02T12:00:00Z")));
+    auto out_of_range = bsoncxx::types::b_date(std::chrono::milliseconds(parse_iso_date("2020-03-15T00:00:00Z")));
+
+    EXPECT_TRUE(filter.matches(make_document(kvp("datetime", in_range), kvp("connected_user", "2")).view()));
+    EXPECT_FALSE(filter.matches(make_document(kvp("datetime", out_of_range), kvp("connected_user", "2")).view()));
+    EXPECT_FALSE(filter.matches(make_document(kvp("datetime", in_range)).view()));
+    EXPECT_FALSE(filter.matches(make_document(kvp("datetime", in_range), kvp("connected_user", "2"),
+        kvp("user", make_document(kvp("lang", "de")))).view()));
+}
+
+TEST(SlidingWindowsTest, slidematchesrebuild) {
+    //(time, user, connected_user), in time order
+    std::vector<std::tuple<int64_t, uint64_t, uint64_t>> interactions = {
+        { 0, 1, 2 }, { 5, 2, 3 }, { 12, 1, 2 }, { 15, 3, 1 }, { 22, 3, 1 }, { 29, 4, 4 }, { 31, 2, 3 }
+    };
+    std::vector<GraphWindow> windows;
+    SlidingWindows series(0, 40, 20, 10, [&windows](GraphWindow&& window) {
+        windows.push_back(std::move(window));
+    });
+    for (const auto& [time, user, connected_user] : interactions) {
+        series.add(time, user, connected_user);
+    }
+    series.finish();
+
+    ASSERT_EQ(windows.size(), 3);
+    for (GraphWindow& window : windows) {
+        //the weights should be what counting the window's interactions from scratch gives
+        std::map<std::pair<uint64_t, uint64_t>, double> expected;
+        for (const auto& [time, user, connected_user] : interactions) {
+            if (time >= window.from && time < window.to && user != connected_user) {
+                expected[{ user, connected_user }]++;
+            }
+        }
+        std::map<std::pair<uint64_t, uint64_t>, double> actual;
+        for (igraph_integer_t e = 0; e < igraph_ecount(window.graph); e++) {
+            actual[{ window.user_ids[IGRAPH_FROM(window.graph, e)], window.user_ids[IGRAPH_TO(window.graph, e)] }] = EAN(window.graph, "weight", e);
+        }
+        EXPECT_EQ(actual, expected) << "window starting at " << window.from;
+        igraph_destroy(window.graph);
+        delete window.graph;
+    }
+}
+
+TEST(InteractionLayersTest, layercolumnsandweighting) {
+    GraphBuilder builder;
+    builder.add(1, 2, "a", InteractionLayer::Retweet);
+    builder.add(1, 2, "b", InteractionLayer::Retweet);
+    builder.add(1, 2, "c", InteractionLayer::Reply);
+    builder.add(2, 3, "d", InteractionLayer::Quote);
+    igraph_t* g = new igraph_t();
+    builder.build(g);
+
+    ASSERT_EQ(igraph_ecount(g), 2);
+    for (igraph_integer_t e = 0; e < igraph_ecount(g); e++) {
+        bool first = IGRAPH_FROM(g, e) == 0;
+        EXPECT_EQ(EAN(g, "weight", e), first ? 3 : 1);
+        EXPECT_EQ(EAN(g, "weight_retweet", e), first ? 2 : 0);
+        EXPECT_EQ(EAN(g, "weight_reply", e), first ? 1 : 0);
+        EXPECT_EQ(EAN(g, "weight_quote", e), first ? 0 : 1);
+    }
+
+    std::vector<double> weights = weigh_layers(g, parse_layer_weighting("retweet=1,reply=0.5"));
+    for (igraph_integer_t e = 0; e < igraph_ecount(g); e++) {
+        EXPECT_EQ(weights[e], IGRAPH_FROM(g, e) == 0 ? 2.5 : 0);
+    }
+    EXPECT_THROW(parse_layer_weighting("likes"), std::invalid_argument);
+    igraph_destroy(g);
+    delete g;
+}
+
+TEST(TweetStoreTest, groupsbyuserinorder) {
+    for (TweetStore::Mode mode : { TweetStore::Mode::Plain, TweetStore::Mode::Compressed }) {
+        TweetStore store(mode);
+        store.add(1, "b1");
+        store.add(0, "a1");
+        store.add(1, "b2");
+        TweetStore other(mode);
+        other.add(0, "c1");
+        other.add(1, "a2");
+        //other's vertex 0 is our 2, and its 1 is our 0
+        store.append(other, { 2, 0 });
+        EXPECT_THROW(store.tweet_count(0), std::logic_error);
+        store.seal(4);
+
+        EXPECT_EQ(store.user_count(), 4);
+        EXPECT_EQ(store.tweets(0), std::vector<std::string>({ "a1", "a2" }));
+        EXPECT_EQ(store.tweets(1), std::vector<std::string>({ "b1", "b2" }));
+        EXPECT_EQ(store.tweets(2), std::vector<std::string>({ "c1" }));
+        EXPECT_EQ(store.tweet_count(3), 0);
+    }
+    TweetStore skipped(TweetStore::Mode::None);
+    skipped.add(0, "text");
+    skipped.seal(1);
+    EXPECT_EQ(skipped.tweet_count(0), 0);
+}
+
+TEST(TweetStoreTest, keepusersacrossblocks) {
+    //enough text for several compressed blocks, kept in runs of consecutive users with gaps between them
+    for (TweetStore::Mode mode : { TweetStore::Mode::Plain, TweetStore::Mode::Compressed }) {
+        TweetStore store(mode);
+        for (uint32_t t = 0; t < 6000; t++) {
+            uint32_t v = t % 300;
+            store.add(v, "user " + std::to_string(v) + " tweet " + std::to_string(t) + std::string(t % 50, 'x'));
+        }
+        //the last user has no tweets
+        store.seal(301);
+        std::vector<uint32_t> new_to_old;
+        std::vector<std::vector<std::string>> expected;
+        size_t expected_tweets = 0;
+        for (uint32_t v = 0; v < 301; v++) {
+            if (v % 7 != 3 && v % 11 != 0) {
+                new_to_old.push_back(v);
+                expected.push_back(store.tweets(v));
+                expected_tweets += expected.back().size();
+            }
+        }
+        store.keep_users(new_to_old);
+        ASSERT_EQ(store.user_count(), new_to_old.size());
+        EXPECT_EQ(store.tweet_count(), expected_tweets);
+        for (uint32_t v = 0; v < new_to_old.size(); v++) {
+            EXPECT_EQ(store.tweets(v), expected[v]);
+        }
+        EXPECT_EQ(store.tweet_count((uint32_t)new_to_old.size() - 1), 0);
+    }
+}
+
+TEST(TermStatisticsTest, tokenises) {
+    std::string scratch;
+    std::vector<std::string> terms;
+    for_each_term("RT @Someone: Don't STOP the #Vote2020 https://t.co/xyz &amp; caf\xc3\xa9 a", scratch, [&terms](std::string_view term) {
+        terms.emplace_back(term);
+    });
+    EXPECT_EQ(terms, std::vector<std::string>({ "rt", "@someone", "don't", "stop", "the", "#vote2020", "caf\xc3\xa9" }));
+
+    //curly quotes, an ellipsis, emoji (with a variation selector), a flag and a no-break space split words like spaces,
+    //other scripts stay in them, and broken utf-8 is dropped
+    terms.clear();
+    for_each_term("\xe2\x80\x9c" "brexit\xe2\x80\x9d\xe2\x80\xa6" "done\xf0\x9f\x98\x82\xf0\x9f\x98\x82vote \xe2\x9d\xa4\xef\xb8\x8flove "
+        "\xf0\x9f\x87\xac\xf0\x9f\x87\xa7uk\xc2\xa0now \xd0\xbc\xd0\xb8\xd1\x80 #\xf0\x9f\x98\x82 ab\xff" "cd", scratch, [&terms](std::string_view term) {
+        terms.emplace_back(term);
+    });
+    EXPECT_EQ(terms, std::vector<std::string>({ "brexit", "done", "vote", "love", "uk", "now", "\xd0\xbc\xd0\xb8\xd1\x80", "ab", "cd" }));
+
+    //right single quotes and modifier letter apostrophes inside a word are apostrophes, written as ', but still split
+    //words at either end of one
+    terms.clear();
+    for_each_term("Don\xe2\x80\x99t won\xca\xbct \xe2\x80\x98quoted\xe2\x80\x99 \xca\xbc" "ab\xca\xbc rock\xe2\x80\x99\xe2\x80\x99roll", scratch, [&terms](std::string_view term) {
+        terms.emplace_back(term);
+    });
+    EXPECT_EQ(terms, std::vector<std::string>({ "don't", "won't", "quoted", "ab", "rock", "roll" }));
+}
+
+TEST(TermStatisticsTest, findsdistinctiveterms) {
+    TweetStore store(TweetStore::Mode::Compressed);
+    std::vector<size_t> membership;
+    for (uint32_t v = 0; v < 300; v++) {
+        membership.push_back(v % 3);
+        const char* texts[] = { "#left wins", "#right wins", "nobody wins" };
+        store.add(v, texts[v % 3]);
+    }
+    store.seal(300);
+    std::vector<CommunityTerms> communities = distinctive_terms(store, membership, 1, 50, 5);
+    ASSERT_EQ(communities.size(), 3);
+    std::map<size_t, std::string> top;
+    for (const CommunityTerms& community : communities) {
+        EXPECT_EQ(community.users, 100);
+        EXPECT_EQ(community.terms, 200);
+        ASSERT_EQ(community.top.size(), 1);
+        top[community.community] = community.top[0].term;
+    }
+    //wins is everywhere, so it doesn't set anyone apart
+    EXPECT_EQ(top[0], "#left");
+    EXPECT_EQ(top[1], "#right");
+    EXPECT_EQ(top[2], "nobody");
+}
+
+TEST(GraphPruningTest, peelstokcore) {
+    //users 1-2-3 form a triangle with a tail 3-4-5, and 6 has a heavy edge to 1 and a light one to 2
+    GraphBuilder builder;
+    std::vector<std::pair<uint64_t, uint64_t>> interactions = { {1, 2}, {2, 3}, {3, 1}, {3, 4}, {4, 5}, {6, 1}, {6, 1}, {6, 2} };
+    for (const auto& [user, connected_user] : interactions) {
+        builder.add(user, connected_user, "tweet");
+    }
+    igraph_t* g = new igraph_t();
+    builder.build(g);
+
+    //by degree alone only the tail goes (5, and then 4). 6 keeps its two edges
+    igraph_t pruned;
+    PruneResult result = prune_graph(g, &pruned, 2, 1);
+    EXPECT_EQ(result.new_to_old, std::vector<uint32_t>({ 0, 1, 2, 5 }));
+    EXPECT_EQ(result.old_to_new[3], -1);
+    EXPECT_EQ(igraph_ecount(&pruned), 5);
+    igraph_destroy(&pruned);
+
+    //dropping the single interactions leaves only 6 -> 1, which can't have two connections
+    result = prune_graph(g, &pruned, 2, 2);
+    EXPECT_EQ(igraph_vcount(&pruned), 0);
+    EXPECT_EQ(result.light_edges, 6);
+    igraph_destroy(&pruned);
+    igraph_destroy(g);
+    delete g;
+}
+
+class CommunityDetectionTest : public ::testing::Test {
+public:
+    //two 5-cliques joined by a single edge
+    igraph_t* two_cliques() {
+        igraph_t* g = new igraph_t();
+        igraph_vector_int_t edges;
+        igraph_vector_int_init(&edges, 0);
+        for (int clique = 0; clique < 2; clique++) {
+            for (int a = 0; a < 5; a++) {
+                for (int b = a + 1; b < 5; b++) {
+                    igraph_vector_int_push_back(&edges, clique * 5 + a);
+                    igraph_vector_int_push_back(&edges, clique * 5 + b);
+                }
+            }
+        }
+        igraph_vector_int_push_back(&edges, 0);
+        igraph_vector_int_push_back(&edges, 5);
+        igraph_create(g, &edges, 10, true);
+        igraph_vector_int_destroy(&edges);
+        return g;
+    }
+};
+
+TEST_F(CommunityDetectionTest, nmi) {
+    EXPECT_DOUBLE_EQ(membership_nmi({ 0, 0, 1, 1 }, { 7, 7, 3, 3 }), 1);
+    EXPECT_LT(membership_nmi({ 0, 0, 1, 1 }, { 0, 1, 0, 1 }), 1e-9);
+}
+
+TEST_F(CommunityDetectionTest, ensemblefindscliques) {
+    igraph_t* g = two_cliques();
+    LeidenEnsemble ensemble = leiden_ensemble(g, NULL, 4, 1);
+    ASSERT_EQ(ensemble.runs.size(), 4);
+    const std::vector<size_t>& best = ensemble.best_run().membership;
+    for (int v = 1; v < 5; v++) {
+        EXPECT_EQ(best[v], best[0]);
+        EXPECT_EQ(best[5 + v], best[5]);
+    }
+    EXPECT_NE(best[0], best[5]);
+    EXPECT_EQ(ensemble.edge_agreement.size(), igraph_ecount(g));
+    EXPECT_DOUBLE_EQ(ensemble.mean_nmi, 1);
+    igraph_destroy(g);
+    delete g;
+}
+
+TEST_F(CommunityDetectionTest, sweepsplitsasresolutiongrows) {
+    igraph_t* g = two_cliques();
+    std::vector<double> weights(igraph_ecount(g), 1.0);
+    ResolutionSweep sweep = resolution_sweep(g, weights, ResolutionQuality::CPM, { 0.05, 0.5, 2 });
+    ASSERT_EQ(sweep.runs.size(), 3);
+    EXPECT_EQ(sweep.runs[0].resolution, 0.05);
+    //the cliques at a low resolution, and singletons once an edge is worth less than the resolution
+    EXPECT_EQ(std::set<size_t>(sweep.runs[0].membership.begin(), sweep.runs[0].membership.end()).size(), 2);
+    EXPECT_EQ(std::set<size_t>(sweep.runs[2].membership.begin(), sweep.runs[2].membership.end()).size(), 10);
+    igraph_destroy(g);
+    delete g;
+}
+
+TEST_F(CommunityDetectionTest, warmstartcarriesusersover) {
+    UserIndex users;
+    for (uint64_t user_id : { 100, 200, 300, 400 }) {
+        users.intern(user_id);
+    }
+    //300 is new, and the communities are renumbered densely
+    user_communities previous = { { 100, 7 }, { 200, 7 }, { 400, 3 }, { 999, 1 } };
+    size_t carried_over = 0;
+    EXPECT_EQ(carry_over_membership(users, previous, &carried_over), std::vector<size_t>({ 0, 0, 2, 1 }));
+    EXPECT_EQ(carried_over, 3);
+
+    //the earlier graph is the two cliques, as users 100-109
+    igraph_t* g = two_cliques();
+    LeidenRun cold = run_leiden(g, NULL, 0);
+    user_communities earlier;
+    for (uint64_t v = 0; v < 10; v++) {
+        earlier[100 + v] = cold.membership[v];
+    }
+    //the later graph gains a third clique of new users 110-114, numbered ahead of the old ones, which keep their edges
+    igraph_vector_int_t edges;
+    igraph_vector_int_init(&edges, 0);
+    igraph_get_edgelist(g, &edges, false);
+    for (igraph_integer_t i = 0; i < igraph_vector_int_size(&edges); i++) {
+        VECTOR(edges)[i] += 5;
+    }
+    for (int a = 0; a < 5; a++) {
+        for (int b = a + 1; b < 5; b++) {
+            igraph_vector_int_push_back(&edges, a);
+            igraph_vector_int_push_back(&edges, b);
+        }
+    }
+    igraph_vector_int_push_back(&edges, 0);
+    igraph_vector_int_push_back(&edges, 5);
+    igraph_t later;
+    igraph_create(&later, &edges, 15, true);
+    igraph_vector_int_destroy(&edges);
+    UserIndex later_users;
+    for (uint64_t user_id : { 110, 111, 112, 113, 114, 100, 101, 102, 103, 104, 105, 106, 107, 108, 109 }) {
+        later_users.intern(user_id);
+    }
+
+    std::vector<size_t> initial = carry_over_membership(later_users, earlier, &carried_over);
+    EXPECT_EQ(carried_over, 10);
+    LeidenRun warm = run_leiden(&later, NULL, 0, &initial);
+    //the old cliques stay together, and the new one forms a community of its own
+    for (int clique = 0; clique < 3; clique++) {
+        for (int v = 1; v < 5; v++) {
+            EXPECT_EQ(warm.membership[clique * 5 + v], warm.membership[clique * 5]);
+        }
+    }
+    EXPECT_EQ(std::set<size_t>(warm.membership.begin(), warm.membership.end()).size(), 3);
+    LeidenRun later_cold = run_leiden(&later, NULL, 0);
+    EXPECT_NEAR(warm.quality, later_cold.quality, 1e-9);
+    igraph_destroy(&later);
+    igraph_destroy(g);
+    delete g;
+}
+
+TEST(ProfilerTest, phasesrecordtimeandallocations) {
+    count_allocations(true);
+    {
+        Profiler::Phase outer("profiler_test_outer");
+        {
+            Profiler::Phase inner("profiler_test_inner");
+            std::vector<int> numbers(1000, 1);
+        }
+    }
+    count_allocations(false);
+    std::vector<PhaseProfile> phases = Profiler::getInstance()->phases();
+    auto find = [&](const std::string& name) {
+        return std::find_if(phases.begin(), phases.end(), [&](const PhaseProfile& p) { return p.name == name; });
+    };
+    auto outer = find("profiler_test_outer");
+    auto inner = find("profiler_test_inner");
+    ASSERT_NE(outer, phases.end());
+    ASSERT_NE(inner, phases.end());
+    //phases come out in the order they started
+    EXPECT_LT(outer, inner);
+    EXPECT_EQ(inner->depth, outer->depth + 1);
+    EXPECT_GE(outer->seconds, inner->seconds);
+    EXPECT_GE(inner->allocations, 1);
+    EXPECT_GE(inner->allocated_bytes, 1000 * sizeof(int));
+    EXPECT_GT(current_rss(), 0);
+    EXPECT_GE(peak_rss(), inner->rss_after);
+}
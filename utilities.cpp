@@ -43,6 +43,8 @@ void print_matrix(const igraph_matrix_t* matrix) {
 	}
 };
 
+#ifdef _WIN32
 void sehTranslator(unsigned int code, EXCEPTION_POINTERS* pExp) {
 	throw std::runtime_error("SEH exception occurred");
-}
\ No newline at end of file
+}
+#endif
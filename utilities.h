@@ -11,6 +11,9 @@
 #include <functional>
 #include <type_traits>
 #include <climits>
+#include <string>
+#include <string_view>
+#include <cstdint>
 
 #include <igraph/igraph.h>
 #include <libleidenalg/GraphHelper.h>
@@ -18,8 +21,10 @@
 #include <libleidenalg/ModularityVertexPartition.h>
 
 #include <chrono>
+#ifdef _WIN32
 #include <windows.h>
 #include <psapi.h>
+#endif
 
 typedef unsigned int uint;
 typedef unsigned char uchar;
@@ -42,7 +47,9 @@ ptr<T> _ptr(Args&&... args) {
 
 void print_graph(const igraph_t* graph);
 void print_matrix(const igraph_matrix_t* matrix);
+#ifdef _WIN32
 void sehTranslator(unsigned int code, EXCEPTION_POINTERS* pExp);
+#endif
 
 //cartesian product, same as itertools.product in python
 template <typename T1, typename T2>
@@ -56,6 +63,11 @@ ptr<std::vector<ptr<std::pair<T1, T2>>>> cartesian_product(const ptr<std::vector
     return product;
 };
 
+//a + b, stopping at the largest count rather than wrapping around
+inline uint32_t saturating_add(uint32_t a, uint32_t b) {
+    return a > UINT32_MAX - b ? UINT32_MAX : a + b;
+}
+
 
 
 #endif 
\ No newline at end of file